@@ -0,0 +1,261 @@
+#include "batch.hpp"
+#include "frame_memory.hpp"
+#include "objreader.hpp"
+#include "rasterizer.hpp"
+#include "tgaimage.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <numbers>
+#include <span>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct FrameTask
+{
+  std::size_t job = 0;
+  int frame = 0;
+};
+
+// plain POSIX I/O: unlike a stream, writing a file does not touch the heap
+bool write_file(const std::string &path, std::span<const std::uint8_t> bytes)
+{
+  const int file = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (file < 0) {
+    std::cerr << "can't open file " << path << "\n";
+    return false;
+  }
+  bool written = true;
+  while (written && !bytes.empty()) {
+    const ssize_t count = ::write(file, bytes.data(), bytes.size());
+    written = count > 0;
+    if (written) { bytes = bytes.subspan(static_cast<std::size_t>(count)); }
+  }
+  written = 0 == ::close(file) && written;
+  if (!written) { std::cerr << "can't write file " << path << "\n"; }
+  return written;
+}
+
+void transform_to_screen(const OBJObject<float> &mesh, std::span<OBJVertex<float>> screen, const BatchJob &job, const int frame)
+{
+  const float t_param = static_cast<float>(frame) / static_cast<float>(job.frames);
+  const float yaw = (job.yaw_start + (t_param * (job.yaw_end - job.yaw_start))) * std::numbers::pi_v<float> / 180.0F;
+  const float pitch = job.pitch * std::numbers::pi_v<float> / 180.0F;
+  const float cos_yaw = std::cos(yaw);
+  const float sin_yaw = std::sin(yaw);
+  const float cos_pitch = std::cos(pitch);
+  const float sin_pitch = std::sin(pitch);
+  const float half_width = static_cast<float>(job.width) / 2;
+  const float half_height = static_cast<float>(job.height) / 2;
+  const float half_z = static_cast<float>(UINT8_MAX) / 2;
+
+  for (std::size_t index = 0; index < mesh.vertices.size(); ++index) {
+    const auto &vert = mesh.vertices[index];
+    const float yawed_x = (vert.get_x() * cos_yaw) + (vert.get_z() * sin_yaw);
+    const float yawed_z = (vert.get_z() * cos_yaw) - (vert.get_x() * sin_yaw);
+    const float pitched_y = (vert.get_y() * cos_pitch) - (yawed_z * sin_pitch);
+    const float pitched_z = (vert.get_y() * sin_pitch) + (yawed_z * cos_pitch);
+    screen[index] = OBJVertex<float>((yawed_x + 1.0F) * half_width,
+      (pitched_y + 1.0F) * half_height,
+      std::clamp(std::round((pitched_z + 1.0F) * half_z), 0.0F, static_cast<float>(UINT8_MAX)));
+  }
+}
+
+}// namespace
+
+bool render_batch_frame(const BatchJob &job,
+  const int frame,
+  const OBJObject<float> &mesh,
+  FrameResources &resources,
+  std::string &output_path)
+{
+  TGAImage &framebuffer = resources.images.acquire(job.width, job.height, TGAImage::RGB);
+  TGAImage &zbuffer = resources.images.acquire(job.width, job.height, TGAImage::GRAYSCALE);
+  const auto screen_vertices = resources.arena.allocate<OBJVertex<float>>(mesh.vertices.size());
+  auto &encoded = resources.byte_buffers.acquire();
+
+  // faces are shaded with face_color, so every run of a manifest writes the same images
+  transform_to_screen(mesh, screen_vertices, job, frame);
+  draw_triangles<float>(framebuffer, screen_vertices, mesh.faces, zbuffer);
+  framebuffer.encode_tga(encoded);
+  expand_output_pattern(job.output_pattern, job.model, frame, output_path);
+  const bool written = write_file(output_path, encoded);
+  resources.reset();
+  return written;
+}
+
+std::string expand_output_pattern(const std::string &pattern, const std::string &model, const int frame)
+{
+  std::string output {};
+  expand_output_pattern(pattern, model, frame, output);
+  return output;
+}
+
+void expand_output_pattern(const std::string &pattern, const std::string &model, const int frame, std::string &output)
+{
+  constexpr std::string_view model_key = "{model}";
+  constexpr std::string_view frame_key = "{frame}";
+  constexpr int frame_digits = 4;
+  output.clear();
+  for (std::size_t pos = 0; pos < pattern.size();) {
+    const std::string_view rest = std::string_view(pattern).substr(pos);
+    if (rest.starts_with(model_key)) {
+      output += model;
+      pos += model_key.size();
+    } else if (rest.starts_with(frame_key)) {
+      // zero padded to frame_digits; to_chars does not allocate like std::format would
+      std::array<char, 16> digits {};
+      const auto [end, error] = std::to_chars(digits.data(), digits.data() + digits.size(), frame);
+      const auto length = static_cast<int>(end - digits.data());
+      if (length < frame_digits) { output.append(static_cast<std::size_t>(frame_digits - length), '0'); }
+      output.append(digits.data(), end);
+      pos += frame_key.size();
+    } else {
+      output += pattern[pos++];
+    }
+  }
+}
+
+bool read_manifest(const std::filesystem::path &manifest_path, BatchManifest &manifest)
+{
+  std::ifstream manifest_stream(manifest_path);
+  if (!manifest_stream.is_open()) {
+    std::cerr << "can't open job manifest " << manifest_path << "\n";
+    return false;
+  }
+  const std::filesystem::path base_dir = manifest_path.parent_path();
+  std::string line {};
+  int line_number = 0;
+  while (std::getline(manifest_stream, line, '\n')) {
+    ++line_number;
+    line = line.substr(0, line.find('#'));
+    std::stringstream line_stream(line);
+    std::string symbol {};
+    if (!(line_stream >> symbol)) { continue; }
+
+    if ("model" == symbol) {
+      BatchModel model {};
+      std::string path {};
+      if (!(line_stream >> model.name >> path)) {
+        std::cerr << manifest_path.string() << ":" << line_number << ": expected 'model <name> <path>'\n";
+        return false;
+      }
+      model.path = std::filesystem::path(path).is_absolute() ? std::filesystem::path(path) : base_dir / path;
+      manifest.models.push_back(model);
+    } else if ("job" == symbol) {
+      BatchJob job {};
+      std::string resolution {};
+      char separator = 0;
+      line_stream >> job.model >> resolution >> job.frames >> job.yaw_start >> job.yaw_end >> job.pitch
+        >> job.output_pattern;
+      std::stringstream resolution_stream(resolution);
+      resolution_stream >> job.width >> separator >> job.height;
+      if (line_stream.fail() || resolution_stream.fail() || 'x' != separator || job.width <= 0 || job.height <= 0
+          || job.frames <= 0) {
+        std::cerr << manifest_path.string() << ":" << line_number
+                  << ": expected 'job <model> <width>x<height> <frames> <yaw start> <yaw end> <pitch> <output>'\n";
+        return false;
+      }
+      const bool known_model = std::any_of(manifest.models.begin(), manifest.models.end(), [&](const BatchModel &model) {
+        return model.name == job.model;
+      });
+      if (!known_model) {
+        std::cerr << manifest_path.string() << ":" << line_number << ": unknown model '" << job.model << "'\n";
+        return false;
+      }
+      manifest.jobs.push_back(job);
+    } else {
+      std::cerr << manifest_path.string() << ":" << line_number << ": unknown entry '" << symbol << "'\n";
+      return false;
+    }
+  }
+  return true;
+}
+
+bool run_batch(const BatchManifest &manifest, unsigned threads, BatchStats &stats)
+{
+  const auto load_start = std::chrono::steady_clock::now();
+  std::map<std::string, OBJObject<float>> meshes;
+  for (const auto &job : manifest.jobs) {
+    if (meshes.contains(job.model)) { continue; }
+    const auto model = std::find_if(manifest.models.begin(), manifest.models.end(), [&](const BatchModel &entry) {
+      return entry.name == job.model;
+    });
+    if (!read_obj(model->path, meshes[job.model])) {
+      std::cerr << "can't read model " << model->path << "\n";
+      return false;
+    }
+  }
+
+  std::vector<FrameTask> tasks;
+  std::vector<const OBJObject<float> *> job_meshes;
+  for (std::size_t job_index = 0; job_index < manifest.jobs.size(); ++job_index) {
+    const auto &job = manifest.jobs[job_index];
+    job_meshes.push_back(&meshes.at(job.model));
+    for (int frame = 0; frame < job.frames; ++frame) {
+      tasks.push_back({ job_index, frame });
+      const std::filesystem::path output(expand_output_pattern(job.output_pattern, job.model, frame));
+      std::error_code error {};
+      if (output.has_parent_path()) { std::filesystem::create_directories(output.parent_path(), error); }
+      if (error) {
+        std::cerr << "can't create output directory " << output.parent_path() << ": " << error.message() << "\n";
+        return false;
+      }
+    }
+  }
+  const auto render_start = std::chrono::steady_clock::now();
+  stats.load_seconds = std::chrono::duration<double>(render_start - load_start).count();
+
+  threads = std::clamp(threads, 1U, static_cast<unsigned>(std::max<std::size_t>(tasks.size(), 1)));
+  std::atomic<std::size_t> next_task { 0 };
+  std::atomic<std::size_t> triangles { 0 };
+  std::atomic<bool> failed { false };
+  {
+    std::vector<std::jthread> workers;
+    for (unsigned worker = 0; worker < threads; ++worker) {
+      workers.emplace_back([&] {
+        FrameResources resources {};
+        std::string output_path {};
+        for (std::size_t task = next_task++; task < tasks.size(); task = next_task++) {
+          const auto &job = manifest.jobs[tasks[task].job];
+          const auto &mesh = *job_meshes[tasks[task].job];
+          // an exception escaping a worker would terminate the process; it fails the frame and the batch instead
+          try {
+            if (!render_batch_frame(job, tasks[task].frame, mesh, resources, output_path)) { failed = true; }
+          } catch (const std::exception &error) {
+            std::cerr << "frame " << tasks[task].frame << " of " << job.model << " failed: " << error.what() << "\n";
+            resources.reset();
+            failed = true;
+          }
+          triangles += mesh.faces.size();
+        }
+      });
+    }
+  }
+  const auto render_stop = std::chrono::steady_clock::now();
+
+  stats.frames = tasks.size();
+  stats.triangles = triangles;
+  stats.threads = threads;
+  stats.render_seconds = std::chrono::duration<double>(render_stop - render_start).count();
+  return !failed;
+}
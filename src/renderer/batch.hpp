@@ -0,0 +1,69 @@
+#ifndef BATCH_HPP
+#define BATCH_HPP
+#include "frame_memory.hpp"
+#include "objreader.hpp"
+
+#include <cstddef>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// A job manifest is a plain text file, one entry per line, '#' starts a comment:
+//
+//   model <name> <obj path>
+//   job <model name> <width>x<height> <frames> <yaw start> <yaw end> <pitch> <output pattern>
+//
+// Model paths are relative to the manifest. Each job renders a turntable: frame i is rotated about the vertical
+// axis by yaw start + i * (yaw end - yaw start) / frames degrees, then tilted by pitch degrees. The output pattern
+// may contain {model} and {frame} (expanded to a zero padded frame number).
+struct BatchModel
+{
+  std::string name;
+  std::filesystem::path path;
+};
+
+struct BatchJob
+{
+  std::string model;
+  int width = 0;
+  int height = 0;
+  int frames = 1;
+  float yaw_start = 0.0F;
+  float yaw_end = 0.0F;
+  float pitch = 0.0F;
+  std::string output_pattern;
+};
+
+struct BatchManifest
+{
+  std::vector<BatchModel> models;
+  std::vector<BatchJob> jobs;
+};
+
+struct BatchStats
+{
+  std::size_t frames = 0;
+  std::size_t triangles = 0;
+  unsigned threads = 0;
+  double load_seconds = 0.0;
+  double render_seconds = 0.0;
+};
+
+bool read_manifest(const std::filesystem::path &manifest_path, BatchManifest &manifest);
+
+// renders every frame of every job, loading each model once and spreading frames over `threads` workers
+bool run_batch(const BatchManifest &manifest, unsigned threads, BatchStats &stats);
+
+std::string expand_output_pattern(const std::string &pattern, const std::string &model, const int frame);
+// same, into output, which keeps its capacity between calls
+void expand_output_pattern(const std::string &pattern, const std::string &model, const int frame, std::string &output);
+
+// Renders one frame of a job and writes it to output_path, the expanded output pattern. Scratch memory comes from
+// resources and output_path keeps its capacity, so once they have grown to the job's size a frame does not allocate.
+bool render_batch_frame(const BatchJob &job,
+  const int frame,
+  const OBJObject<float> &mesh,
+  FrameResources &resources,
+  std::string &output_path);
+
+#endif //BATCH_HPP
@@ -0,0 +1,710 @@
+#include "tgaimage.hpp"
+#include "objreader.hpp"
+#include "rasterizer.hpp"
+#include "msaa.hpp"
+#include "frame_memory.hpp"
+#include "compressed_mesh.hpp"
+#include "meshlets.hpp"
+#include "lines.hpp"
+#include "deferred.hpp"
+#include "streaming.hpp"
+#include "sort_last.hpp"
+#include "incremental.hpp"
+#include "shadow.hpp"
+
+#include <CLI/CLI.hpp>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstddef>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <numbers>
+#include <print>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// best-of-n wall time in milliseconds
+template<typename Func> double time_ms(const int repeats, Func &&func)
+{
+  double best = std::numeric_limits<double>::max();
+  for (int run = 0; run < repeats; ++run) {
+    const auto start = std::chrono::steady_clock::now();
+    func();
+    const auto stop = std::chrono::steady_clock::now();
+    best = std::min(best, std::chrono::duration<double, std::milli>(stop - start).count());
+  }
+  return best;
+}
+
+double to_mib(const std::size_t bytes) { return static_cast<double>(bytes) / (1024.0 * 1024.0); }
+
+// unit sphere in normalised device coordinates wound counter-clockwise from outside, used when no model is available
+OBJObject<float> make_sphere_mesh(const int rings, const int segments)
+{
+  OBJObject<float> mesh {};
+  for (int ring = 0; ring <= rings; ++ring) {
+    const float theta = std::numbers::pi_v<float> * static_cast<float>(ring) / static_cast<float>(rings);
+    for (int segment = 0; segment < segments; ++segment) {
+      const float phi = 2.0F * std::numbers::pi_v<float> * static_cast<float>(segment) / static_cast<float>(segments);
+      mesh.vertices.emplace_back(0.9F * std::sin(theta) * std::cos(phi), 0.9F * std::cos(theta), 0.9F * std::sin(theta) * std::sin(phi));
+    }
+  }
+  for (int ring = 0; ring < rings; ++ring) {
+    for (int segment = 0; segment < segments; ++segment) {
+      const int next = (segment + 1) % segments;
+      const int v00 = (ring * segments) + segment + 1;
+      const int v01 = (ring * segments) + next + 1;
+      const int v10 = ((ring + 1) * segments) + segment + 1;
+      const int v11 = ((ring + 1) * segments) + next + 1;
+      mesh.faces.emplace_back(v00, v11, v10);
+      mesh.faces.emplace_back(v00, v01, v11);
+    }
+  }
+  return mesh;
+}
+
+void bench_msaa(const OBJObject<float> &mesh, const int size, const int repeats)
+{
+  std::print("\n== msaa ({0}x{0}, {1} faces) ==\n", size, mesh.faces.size());
+
+  TGAImage color_fb(size, size, TGAImage::RGB);
+  TGAImage depth_fb(size, size, TGAImage::GRAYSCALE);
+  const TGAColor clear_color {};
+  const double no_aa_ms = time_ms(repeats, [&] {
+    color_fb = TGAImage(size, size, TGAImage::RGB);
+    depth_fb = TGAImage(size, size, TGAImage::GRAYSCALE);
+    draw_triangles(color_fb, mesh, clear_color, depth_fb);
+  });
+  const auto no_aa_bytes = static_cast<std::size_t>(size * size) * (TGAImage::RGB + TGAImage::GRAYSCALE);
+  std::print("{:<10} {:>10.3f} ms {:>10.2f} MiB\n", "no aa", no_aa_ms, to_mib(no_aa_bytes));
+
+  for (const int samples : { 4, 8 }) {
+    MSAAFramebuffer msaa(size, size, samples);
+    const double msaa_ms = time_ms(repeats, [&] {
+      msaa.clear();
+      draw_triangles_msaa(msaa, mesh, [](const std::size_t face, float, float, float) { return face_color(face); });
+      msaa.resolve(color_fb);
+    });
+    const double resolve_ms = time_ms(repeats, [&] { msaa.resolve(color_fb); });
+    const double complex_pct =
+      100.0 * static_cast<double>(msaa.complex_pixels()) / static_cast<double>(size * size);
+    std::print("{:<10} {:>10.3f} ms {:>10.2f} MiB  (x{:.2f} time, x{:.2f} memory, supersampled {:.2f} MiB, "
+               "resolve {:.3f} ms, {:.1f}% edge pixels, slot pool peak {:.2f} MiB)\n",
+      std::to_string(samples) + "x msaa",
+      msaa_ms,
+      to_mib(msaa.memory_bytes()),
+      msaa_ms / no_aa_ms,
+      static_cast<double>(msaa.memory_bytes()) / static_cast<double>(no_aa_bytes),
+      to_mib(msaa.supersampled_bytes()),
+      resolve_ms,
+      complex_pct,
+      to_mib(msaa.pool_high_water_bytes()));
+  }
+}
+
+void bench_vertex_formats(const OBJObject<float> &mesh, const int size, const int repeats)
+{
+  std::print("\n== compressed vertex formats ({} vertices, {} faces) ==\n", mesh.vertices.size(), mesh.faces.size());
+
+  CompressedMesh compressed {};
+  const double build_ms = time_ms(1, [&] { compressed = compress_mesh(mesh); });
+  const std::size_t float_bytes = (mesh.vertices.size() * sizeof(OBJVertex<float>))
+                                  + (mesh.faces.size() * sizeof(OBJFaceElements))
+                                  + ((mesh.normals.size() + mesh.texture_coords.size()) * sizeof(OBJVertex<float>))
+                                  + ((mesh.face_normal_indices.size() + mesh.face_texture_indices.size()) * sizeof(std::array<int, 3>));
+  std::print("build {:.3f} ms, {} sub-meshes, {} vertices after attribute splitting\n",
+    build_ms,
+    compressed.submeshes.size(),
+    compressed.vertex_count());
+  std::print("memory: float {:.2f} MiB, compressed {:.2f} MiB (x{:.2f})\n",
+    to_mib(float_bytes),
+    to_mib(compressed.memory_bytes()),
+    static_cast<double>(float_bytes) / static_cast<double>(compressed.memory_bytes()));
+
+  // transform stage alone: read positions, write screen space vertices into the frame arena
+  const TGAImage viewport(size, size, TGAImage::GRAYSCALE);
+  FrameArena arena;
+  const float half_size = static_cast<float>(size / 2);
+  const float half_z = static_cast<float>(UINT8_MAX) / 2;
+  const double float_transform_ms = time_ms(repeats, [&] {
+    const auto screen = arena.allocate<OBJVertex<float>>(mesh.vertices.size());
+    for (std::size_t index = 0; index < mesh.vertices.size(); ++index) {
+      const auto &vert = mesh.vertices[index];
+      screen[index] = OBJVertex<float>((vert.get_x() + 1.0F) * half_size, (vert.get_y() + 1.0F) * half_size, std::round((vert.get_z() + 1.0F) * half_z));
+    }
+    arena.reset();
+  });
+  const double compressed_transform_ms = time_ms(repeats, [&] {
+    for (const auto &submesh : compressed.submeshes) {
+      transform_submesh(compressed, submesh, viewport, arena.allocate<OBJVertex<float>>(submesh.positions.size()));
+    }
+    arena.reset();
+  });
+  const auto gib_per_s = [](const std::size_t bytes, const double millis) {
+    return static_cast<double>(bytes) / (millis * 1e-3) / (1024.0 * 1024.0 * 1024.0);
+  };
+  std::print("{:<12} {:>10.3f} ms {:>8.1f} Mvert/s {:>7.2f} GiB/s position reads\n",
+    "float",
+    float_transform_ms,
+    static_cast<double>(mesh.vertices.size()) / float_transform_ms * 1e-3,
+    gib_per_s(mesh.vertices.size() * sizeof(OBJVertex<float>), float_transform_ms));
+  std::print("{:<12} {:>10.3f} ms {:>8.1f} Mvert/s {:>7.2f} GiB/s position reads\n",
+    "compressed",
+    compressed_transform_ms,
+    static_cast<double>(compressed.vertex_count()) / compressed_transform_ms * 1e-3,
+    gib_per_s(compressed.position_bytes(), compressed_transform_ms));
+
+  // whole frame through the z-buffer rasterizer
+  OBJObject<float> screen_mesh = mesh;
+  screen_mesh.viewport_transform(viewport);
+  TGAImage color_fb(size, size, TGAImage::RGB);
+  TGAImage depth_fb(size, size, TGAImage::GRAYSCALE);
+  const double float_draw_ms = time_ms(repeats, [&] {
+    color_fb.clear();
+    depth_fb.clear();
+    draw_triangles<float>(color_fb, screen_mesh.vertices, screen_mesh.faces, depth_fb);
+  });
+  const double compressed_draw_ms = time_ms(repeats, [&] {
+    color_fb.clear();
+    depth_fb.clear();
+    draw_compressed(color_fb, compressed, depth_fb, arena);
+    arena.reset();
+  });
+  std::print("frame: float {:.3f} ms, compressed {:.3f} ms (transform excluded for float)\n", float_draw_ms, compressed_draw_ms);
+
+  // error bounds: theoretical half step, and what the mesh actually sees
+  float position_error = 0.0F;
+  for (const auto &vert : mesh.vertices) {
+    const auto decoded = compressed.decode_position(compressed.quantize_position(vert.vertex_coords));
+    for (std::size_t axis = 0; axis < 3; ++axis) {
+      position_error = std::max(position_error, std::abs(decoded.at(axis) - vert.vertex_coords.at(axis)));
+    }
+  }
+  const float position_bound = 0.5F * std::max({ compressed.step[0], compressed.step[1], compressed.step[2] });
+
+  // mesh normals when present, otherwise a dense set of directions
+  std::vector<std::array<float, 3>> directions;
+  for (const auto &normal : mesh.normals) { directions.push_back({ normal.get_x(), normal.get_y(), normal.get_z() }); }
+  if (directions.empty()) {
+    constexpr int direction_count = 100000;
+    for (int index = 0; index < direction_count; ++index) {
+      const float height = 1.0F - (2.0F * (static_cast<float>(index) + 0.5F) / direction_count);
+      const float radius = std::sqrt(1.0F - (height * height));
+      const float angle = static_cast<float>(index) * std::numbers::pi_v<float> * (3.0F - std::sqrt(5.0F));
+      directions.push_back({ radius * std::cos(angle), height, radius * std::sin(angle) });
+    }
+  }
+  float normal_error_deg = 0.0F;
+  for (const auto &direction : directions) {
+    const float length = std::sqrt((direction[0] * direction[0]) + (direction[1] * direction[1]) + (direction[2] * direction[2]));
+    if (0.0F == length) { continue; }
+    const auto decoded = decode_octahedral(encode_octahedral(direction));
+    const float cosine = ((decoded[0] * direction[0]) + (decoded[1] * direction[1]) + (decoded[2] * direction[2])) / length;
+    normal_error_deg = std::max(normal_error_deg, std::acos(std::min(1.0F, cosine)) * 180.0F / std::numbers::pi_v<float>);
+  }
+
+  float uv_error = 0.0F;
+  for (const auto &uv : mesh.texture_coords) {
+    uv_error = std::max({ uv_error,
+      std::abs(half_to_float(float_to_half(uv.get_x())) - uv.get_x()),
+      std::abs(half_to_float(float_to_half(uv.get_y())) - uv.get_y()) });
+  }
+  std::print("errors: position {:.3g} (bound {:.3g}, {:.4f} px), normal {:.4f} deg, uv {:.3g}{}\n",
+    position_error,
+    position_bound,
+    position_bound * half_size,
+    normal_error_deg,
+    uv_error,
+    mesh.texture_coords.empty() ? " (mesh has no uvs)" : "");
+}
+
+
+void bench_meshlets(const std::string &model_path, const OBJObject<float> &mesh, const int size, const int repeats)
+{
+  std::print("\n== meshlet culling ({} faces) ==\n", mesh.faces.size());
+
+  OBJObject<float> clustered = mesh;
+  MeshletBVH bvh {};
+  const double build_ms = time_ms(1, [&] { bvh = build_meshlets(clustered); });
+  std::print("build {:.3f} ms: {} meshlets, {} bvh nodes\n", build_ms, bvh.meshlets.size(), bvh.nodes.size());
+
+  // the cache only applies to files on disk
+  if (std::filesystem::exists(model_path)) {
+    OBJObject<float> cached = mesh;
+    bool from_cache = false;
+    load_or_build_meshlets(model_path, cached, from_cache);
+    MeshletBVH reloaded {};
+    const double cache_ms = time_ms(repeats, [&] {
+      cached = mesh;
+      read_meshlet_cache(model_path, cached, reloaded);
+    });
+    std::print("cache read {:.3f} ms (mesh copy included, x{:.1f} faster than building)\n", cache_ms, build_ms / cache_ms);
+  }
+
+  // views as rendered by the batch turntable: rotate the mesh, then cull against the unit box
+  const TGAImage viewport(size, size, TGAImage::GRAYSCALE);
+  TGAImage color_fb(size, size, TGAImage::RGB);
+  TGAImage depth_fb(size, size, TGAImage::GRAYSCALE);
+  std::vector<std::uint32_t> visible;
+  const auto run_view = [&](const char *name, const ClusterView &view) {
+    OBJObject<float> rotated = clustered;
+    for (auto &vert : rotated.vertices) {
+      const auto coords = vert.vertex_coords;
+      for (std::size_t axis = 0; axis < 3; ++axis) {
+        vert.vertex_coords.at(axis) = (view.rotation.at(axis)[0] * coords[0]) + (view.rotation.at(axis)[1] * coords[1])
+                                      + (view.rotation.at(axis)[2] * coords[2]);
+      }
+    }
+    rotated.viewport_transform(viewport);
+
+    CullStats stats {};
+    const double cull_ms = time_ms(repeats, [&] {
+      visible.clear();
+      stats = {};
+      cull_meshlets(bvh, view, visible, stats);
+    });
+    const double all_ms = time_ms(repeats, [&] {
+      color_fb.clear();
+      depth_fb.clear();
+      draw_triangles<float>(color_fb, rotated.vertices, rotated.faces, depth_fb);
+    });
+    const double culled_ms = time_ms(repeats, [&] {
+      visible.clear();
+      CullStats frame_stats {};
+      cull_meshlets(bvh, view, visible, frame_stats);
+      color_fb.clear();
+      depth_fb.clear();
+      draw_meshlets<float>(color_fb, rotated.vertices, rotated.faces, bvh, visible, depth_fb);
+    });
+    std::print("{:<16} culled {:>5.1f}% meshlets {:>5.1f}% faces, {} nodes visited, cull {:.3f} ms, frame {:.3f} -> {:.3f} ms\n",
+      name,
+      100.0 * (1.0 - (static_cast<double>(stats.meshlets_visible) / static_cast<double>(bvh.meshlets.size()))),
+      100.0 * (1.0 - (static_cast<double>(stats.faces_visible) / static_cast<double>(clustered.faces.size()))),
+      stats.nodes_visited,
+      cull_ms,
+      all_ms,
+      culled_ms);
+  };
+  run_view("front", make_turntable_view(0.0F, 0.0F));
+  run_view("yaw 90", make_turntable_view(90.0F, 0.0F));
+  run_view("yaw 45 pitch 30", make_turntable_view(45.0F, 30.0F));
+  ClusterView zoomed = make_turntable_view(0.0F, 0.0F);
+  zoomed.box_min = { 0.0F, 0.0F, -1.0F };
+  run_view("upper right", zoomed);
+}
+
+void bench_lines(const OBJObject<float> &screen_mesh, const int size, const int repeats)
+{
+  std::print("\n== lines ({0}x{0}) ==\n", size);
+
+  std::vector<std::array<std::uint32_t, 2>> edges;
+  const double extract_ms = time_ms(repeats, [&] { edges = extract_edges(screen_mesh.faces); });
+  std::print("edge extraction {:.3f} ms: {} unique edges instead of {} face edges\n",
+    extract_ms,
+    edges.size(),
+    screen_mesh.faces.size() * 3);
+
+  TGAImage color_fb(size, size, TGAImage::RGB);
+  TGAImage depth_fb(size, size, TGAImage::GRAYSCALE);
+  const TGAColor line_color(255, 255, 255, 255);
+  const double wire_ms = time_ms(repeats, [&] {
+    color_fb.clear();
+    draw_wireframe<float>(color_fb, screen_mesh.vertices, edges, line_color);
+  });
+  draw_triangles<float>(color_fb, screen_mesh.vertices, screen_mesh.faces, depth_fb);
+  const double overlay_ms = time_ms(repeats, [&] {
+    draw_wireframe<float>(color_fb, screen_mesh.vertices, edges, line_color, &depth_fb);
+  });
+  std::print("wireframe {:.3f} ms, depth-tested overlay {:.3f} ms ({:.1f} Medges/s)\n",
+    wire_ms,
+    overlay_ms,
+    static_cast<double>(edges.size()) / wire_ms * 1e-3);
+
+  // long lines across and beyond the viewport, half of them need clipping
+  constexpr std::size_t line_count = 10000;
+  std::vector<LineSegment> lines(line_count);
+  std::uint32_t state = 1;
+  const auto next_coord = [&] {
+    state = (state * 1664525U) + 1013904223U;
+    return static_cast<int>(state % static_cast<std::uint32_t>(2 * size)) - (size / 2);
+  };
+  std::size_t pixels = 0;
+  for (auto &line : lines) {
+    line = { next_coord(), next_coord(), 0, next_coord(), next_coord(), 0 };
+    LineSegment clipped = line;
+    if (clip_line(clipped, size, size)) {
+      pixels += static_cast<std::size_t>(std::max(std::abs(clipped.x1 - clipped.x0), std::abs(clipped.y1 - clipped.y0)) + 1);
+    }
+  }
+  const double batch_ms = time_ms(repeats, [&] { draw_lines(color_fb, lines, line_color); });
+  const double single_ms = time_ms(repeats, [&] {
+    for (const auto &line : lines) { draw_line(line.x0, line.y0, line.x1, line.y1, color_fb, line_color); }
+  });
+  std::print("{} random lines: batched {:.3f} ms ({:.1f} Mpixel/s), one call per line {:.3f} ms\n",
+    line_count,
+    batch_ms,
+    static_cast<double>(pixels) / batch_ms * 1e-3,
+    single_ms);
+}
+
+void bench_deferred(const OBJObject<float> &screen_mesh, const int size, const int repeats)
+{
+  std::print("\n== depth pre-pass / deferred shading ({0}x{0}) ==\n", size);
+
+  // stand-in for real lighting: per-face normal, Lambert plus a Blinn-Phong lobe with a few iterations of work
+  std::vector<std::array<float, 3>> normals(screen_mesh.faces.size());
+  for (std::size_t face = 0; face < screen_mesh.faces.size(); ++face) {
+    const auto corners = face_corners(screen_mesh.vertices, screen_mesh.faces[face]);
+    const std::array<float, 3> edge1 { static_cast<float>(corners[1][0] - corners[0][0]), static_cast<float>(corners[1][1] - corners[0][1]), static_cast<float>(corners[1][2] - corners[0][2]) };
+    const std::array<float, 3> edge2 { static_cast<float>(corners[2][0] - corners[0][0]), static_cast<float>(corners[2][1] - corners[0][1]), static_cast<float>(corners[2][2] - corners[0][2]) };
+    std::array<float, 3> normal { (edge1[1] * edge2[2]) - (edge1[2] * edge2[1]), (edge1[2] * edge2[0]) - (edge1[0] * edge2[2]), (edge1[0] * edge2[1]) - (edge1[1] * edge2[0]) };
+    const float length = std::sqrt((normal[0] * normal[0]) + (normal[1] * normal[1]) + (normal[2] * normal[2]));
+    if (length > 0.0F) { normal = { normal[0] / length, normal[1] / length, std::abs(normal[2]) / length }; }
+    normals[face] = normal;
+  }
+  const auto lit = [&](const std::size_t face, const float lam1, const float lam2, const float lam3) {
+    const auto &normal = normals[face];
+    float intensity = 0.0F;
+    constexpr int lights = 8;
+    for (int light = 0; light < lights; ++light) {
+      const float angle = static_cast<float>(light) * (2.0F * std::numbers::pi_v<float> / lights);
+      const float diffuse = std::max(0.0F, (normal[0] * 0.5F * std::cos(angle)) + (normal[1] * 0.5F * std::sin(angle)) + (normal[2] * 0.7F));
+      intensity += (0.08F * diffuse) + (0.05F * std::pow(diffuse, 16.0F + (8.0F * lam1)));
+    }
+    const auto base = face_color(face);
+    const float shade = std::min(1.0F, intensity) * (0.8F + (0.2F * (lam2 - lam3)));
+    return TGAColor(static_cast<std::uint8_t>(static_cast<float>(base[0]) * shade),
+      static_cast<std::uint8_t>(static_cast<float>(base[1]) * shade),
+      static_cast<std::uint8_t>(static_cast<float>(base[2]) * shade),
+      UINT8_MAX);
+  };
+
+  TGAImage color_fb(size, size, TGAImage::RGB);
+  TGAImage depth_fb(size, size, TGAImage::GRAYSCALE);
+  std::size_t forward_calls = 0;
+  const double forward_ms = time_ms(repeats, [&] {
+    color_fb.clear();
+    depth_fb.clear();
+    forward_calls = shade_forward(color_fb, depth_fb, screen_mesh.vertices, screen_mesh.faces, lit);
+  });
+  std::size_t covered = 0;
+  for (int y = 0; y < size; ++y) {
+    for (int x = 0; x < size; ++x) { covered += depth_fb.get(x, y)[0] > 0 ? 1U : 0U; }
+  }
+  const auto per_pixel = [&](const std::size_t calls) {
+    return static_cast<double>(calls) / static_cast<double>(std::max<std::size_t>(covered, 1));
+  };
+  std::print("{} covered pixels, {} faces\n", covered, screen_mesh.faces.size());
+  std::print("{:<20} {:>10.3f} ms  {:.2f} shader invocations per pixel\n", "forward", forward_ms, per_pixel(forward_calls));
+
+  const double prepass_ms = time_ms(repeats, [&] {
+    depth_fb.clear();
+    depth_prepass(depth_fb, screen_mesh.vertices, screen_mesh.faces);
+  });
+  std::size_t equal_calls = 0;
+  FrameArena arena {};
+  const double equal_ms = time_ms(repeats, [&] {
+    color_fb.clear();
+    equal_calls = shade_equal_depth(color_fb, depth_fb, screen_mesh.vertices, screen_mesh.faces, arena, lit);
+    arena.reset();
+  });
+  std::print("{:<20} {:>10.3f} ms  {:.2f} shader invocations per pixel (depth {:.3f} ms + shading {:.3f} ms)\n",
+    "pre-pass + equal",
+    prepass_ms + equal_ms,
+    per_pixel(equal_calls),
+    prepass_ms,
+    equal_ms);
+
+  VisibilityBuffer visibility(size, size);
+  const double visibility_ms = time_ms(repeats, [&] {
+    visibility.clear();
+    depth_fb.clear();
+    fill_visibility(visibility, depth_fb, screen_mesh.vertices, screen_mesh.faces);
+  });
+  std::size_t resolve_calls = 0;
+  const double resolve_ms = time_ms(repeats, [&] {
+    color_fb.clear();
+    resolve_calls = shade_visibility(color_fb, visibility, lit);
+  });
+  std::print("{:<20} {:>10.3f} ms  {:.2f} shader invocations per pixel (visibility {:.3f} ms + shading {:.3f} ms, {:.2f} MiB)\n",
+    "visibility buffer",
+    visibility_ms + resolve_ms,
+    per_pixel(resolve_calls),
+    visibility_ms,
+    resolve_ms,
+    to_mib(visibility.memory_bytes()));
+}
+
+void bench_streaming(const std::string &model_path, const OBJObject<float> &mesh, const int size, const int repeats)
+{
+  std::print("\n== out-of-core streaming ({0}x{0}, {1} faces) ==\n", size, mesh.faces.size());
+
+  // stream the model file, or the procedural mesh written out as OBJ
+  std::filesystem::path obj_path = model_path;
+  const bool temporary_obj = !std::filesystem::exists(obj_path);
+  if (temporary_obj) {
+    obj_path = std::filesystem::temp_directory_path() / "bloatedrenderer_bench.obj";
+    std::ofstream out(obj_path);
+    for (const auto &vert : mesh.vertices) { out << "v " << vert.get_x() << ' ' << vert.get_y() << ' ' << vert.get_z() << '\n'; }
+    for (const auto &face : mesh.faces) {
+      out << "f " << face.face_vertices[0] << ' ' << face.face_vertices[1] << ' ' << face.face_vertices[2] << '\n';
+    }
+  }
+  const auto binary_path = std::filesystem::temp_directory_path() / "bloatedrenderer_bench.brmesh";
+
+  TGAImage expected(size, size, TGAImage::RGB);
+  TGAImage expected_depth(size, size, TGAImage::GRAYSCALE);
+  std::size_t in_memory_bytes = 0;
+  const double in_memory_ms = time_ms(repeats, [&] {
+    OBJObject<float> loaded {};
+    read_obj(obj_path, loaded);
+    loaded.viewport_transform(expected);
+    expected.clear();
+    expected_depth.clear();
+    shade_forward(expected, expected_depth, loaded.vertices, loaded.faces, [](const std::size_t face, float, float, float) {
+      return face_color(face);
+    });
+    in_memory_bytes = ((loaded.vertices.capacity() + loaded.texture_coords.capacity() + loaded.normals.capacity()) * sizeof(OBJVertex<float>))
+                      + (loaded.faces.capacity() * sizeof(OBJFaceElements))
+                      + ((loaded.face_texture_indices.capacity() + loaded.face_normal_indices.capacity()) * sizeof(std::array<int, 3>));
+  });
+  std::print("{:<22} {:>10.3f} ms  peak mesh memory {:>8.2f} MiB\n", "in memory (read_obj)", in_memory_ms, to_mib(in_memory_bytes));
+
+  const auto same_image = [&](const TGAImage &lhs, const TGAImage &rhs) {
+    for (int y = 0; y < size; ++y) {
+      for (int x = 0; x < size; ++x) {
+        for (int channel = 0; channel < lhs.bytes_per_pixel(); ++channel) {
+          if (lhs.get(x, y)[channel] != rhs.get(x, y)[channel]) { return false; }
+        }
+      }
+    }
+    return true;
+  };
+
+  TGAImage color_fb(size, size, TGAImage::RGB);
+  TGAImage depth_fb(size, size, TGAImage::GRAYSCALE);
+  for (const std::size_t budget_kib : { 256U, 1024U, 8192U }) {
+    StreamOptions options {};
+    options.memory_budget = budget_kib * 1024;
+    if (!convert_to_binary_mesh(obj_path, binary_path, options.chunk_bytes())) { continue; }
+    for (const auto &[name, path] : { std::pair { "obj", obj_path }, std::pair { "binary", binary_path } }) {
+      StreamStats stats {};
+      const double stream_ms = time_ms(repeats, [&] {
+        color_fb.clear();
+        depth_fb.clear();
+        stats = {};
+        render_streaming(path, options, color_fb, depth_fb, stats);
+      });
+      std::print("{:<22} {:>10.3f} ms  peak mesh memory {:>8.2f} MiB, {} chunks, read {:.3f} ms, raster waited {:.3f} ms, {}\n",
+        std::string(name) + " @ " + std::to_string(budget_kib) + " KiB",
+        stream_ms,
+        to_mib(stats.peak_bytes),
+        stats.chunks,
+        stats.read_seconds * 1e3,
+        stats.wait_seconds * 1e3,
+        same_image(expected, color_fb) && same_image(expected_depth, depth_fb) ? "matches in-memory" : "MISMATCH");
+    }
+  }
+
+  std::filesystem::remove(binary_path);
+  if (temporary_obj) { std::filesystem::remove(obj_path); }
+}
+
+void bench_sort_last(const OBJObject<float> &screen_mesh, const int size, const int repeats)
+{
+  std::print("\n== sort-last multi-process ({0}x{0}, {1} faces) ==\n", size, screen_mesh.faces.size());
+
+  TGAImage expected(size, size, TGAImage::RGB);
+  TGAImage expected_depth(size, size, TGAImage::GRAYSCALE);
+  const double single_ms = time_ms(repeats, [&] {
+    expected.clear();
+    expected_depth.clear();
+    shade_forward(expected, expected_depth, screen_mesh.vertices, screen_mesh.faces, [](const std::size_t face, float, float, float) {
+      return face_color(face);
+    });
+  });
+  std::print("{:<22} {:>10.3f} ms\n", "single process", single_ms);
+
+  TGAImage color_fb(size, size, TGAImage::RGB);
+  TGAImage depth_fb(size, size, TGAImage::GRAYSCALE);
+  for (const auto method : { CompositeMethod::binary_swap, CompositeMethod::tree }) {
+    for (const int workers : { 1, 2, 4, 8, 16 }) {
+      SortLastStats stats {};
+      const double wall_ms = time_ms(repeats, [&] { render_sort_last(screen_mesh, workers, method, color_fb, depth_fb, stats); });
+      bool matches = true;
+      for (int y = 0; y < size && matches; ++y) {
+        for (int x = 0; x < size && matches; ++x) {
+          matches = color_fb.get(x, y)[0] == expected.get(x, y)[0] && depth_fb.get(x, y)[0] == expected_depth.get(x, y)[0];
+        }
+      }
+      std::print("{:<22} {:>10.3f} ms  x{:.2f} speedup, render {:.3f} ms, wait {:.3f} ms, composite {:.3f} ms ({:.1f}%), gather {:.3f} ms, "
+                 "{:.1f} MiB shared, {}\n",
+        (CompositeMethod::binary_swap == method ? "binary swap x" : "tree x") + std::to_string(workers),
+        wall_ms,
+        single_ms / wall_ms,
+        stats.render_seconds * 1e3,
+        stats.wait_seconds * 1e3,
+        stats.composite_seconds * 1e3,
+        100.0 * stats.composite_seconds * 1e3 / wall_ms,
+        stats.gather_seconds * 1e3,
+        to_mib(stats.shared_bytes),
+        matches ? "matches single process" : "MISMATCH");
+    }
+  }
+}
+
+// a grid of copies of the mesh, a varying number of which move every frame
+void bench_incremental(const OBJObject<float> &mesh, const int size, const int repeats)
+{
+  constexpr int grid = 4;
+  constexpr float cell = 2.0F / static_cast<float>(grid);
+  std::vector<ObjectPlacement> placements;
+  IncrementalRenderer renderer(size, size);
+  for (int row = 0; row < grid; ++row) {
+    for (int column = 0; column < grid; ++column) {
+      placements.push_back({ { -1.0F + (cell * (static_cast<float>(column) + 0.5F)), -1.0F + (cell * (static_cast<float>(row) + 0.5F)), 0.0F },
+        cell * 0.45F,
+        true });
+      renderer.add_object(mesh, placements.back());
+    }
+  }
+  std::print("\n== incremental re-rendering ({0}x{0}, {1} objects x {2} faces, {3}px tiles) ==\n",
+    size,
+    placements.size(),
+    mesh.faces.size(),
+    renderer.tile_size());
+
+  const double full_ms = time_ms(repeats, [&] {
+    renderer.invalidate_all();
+    renderer.render_frame();
+  });
+  std::print("{:<22} {:>10.3f} ms\n", "full redraw", full_ms);
+
+  // moved objects shift back and forth by a few pixels, like an animation step
+  int frame = 0;
+  for (const std::size_t moving : { std::size_t { 0 }, std::size_t { 1 }, std::size_t { 2 }, std::size_t { 4 }, std::size_t { 8 }, placements.size() }) {
+    IncrementalStats stats {};
+    const double frame_ms = time_ms(repeats, [&] {
+      const float shift = 0 == (++frame % 2) ? 0.01F : -0.01F;
+      for (std::size_t object = 0; object < moving; ++object) {
+        ObjectPlacement placement = placements[object];
+        placement.offset[0] += shift;
+        renderer.set_placement(object, placement);
+      }
+      stats = renderer.render_frame();
+    });
+
+    IncrementalRenderer reference(size, size, renderer.tile_size());
+    for (std::size_t object = 0; object < placements.size(); ++object) {
+      ObjectPlacement placement = placements[object];
+      if (object < moving) { placement.offset[0] += 0 == (frame % 2) ? 0.01F : -0.01F; }
+      reference.add_object(mesh, placement);
+    }
+    reference.render_frame();
+    bool matches = true;
+    for (int y = 0; y < size && matches; ++y) {
+      for (int x = 0; x < size && matches; ++x) {
+        matches = renderer.color().get(x, y)[0] == reference.color().get(x, y)[0] && renderer.depth().get(x, y)[0] == reference.depth().get(x, y)[0];
+      }
+    }
+    std::print("{:<22} {:>10.3f} ms  x{:.2f} vs full, {:5.1f}% of tiles dirty in {} regions, {} faces redrawn, {}\n",
+      std::to_string(moving) + " of " + std::to_string(placements.size()) + " moved",
+      frame_ms,
+      full_ms / frame_ms,
+      100.0 * stats.dirty_fraction(),
+      stats.regions.size(),
+      stats.faces_drawn,
+      matches ? "matches full redraw" : "MISMATCH");
+  }
+}
+
+// shadow pass from a directional light against the main visibility + shading pass, per shadow map resolution
+void bench_shadow(const OBJObject<float> &mesh, const OBJObject<float> &screen_mesh, const int size, const int repeats)
+{
+  std::print("\n== shadow mapping ({0}x{0}, {1} faces) ==\n", size, screen_mesh.faces.size());
+
+  TGAImage color_fb(size, size, TGAImage::RGB);
+  TGAImage depth_fb(size, size, TGAImage::GRAYSCALE);
+  VisibilityBuffer visibility(size, size);
+  const double visibility_ms = time_ms(repeats, [&] {
+    visibility.clear();
+    depth_fb.clear();
+    fill_visibility(visibility, depth_fb, screen_mesh.vertices, screen_mesh.faces);
+  });
+  const double unshadowed_ms = time_ms(repeats, [&] {
+    shade_visibility(color_fb, visibility, [](const std::size_t face, float, float, float) { return face_color(face); });
+  });
+  std::print("{:<26} {:>10.3f} ms  (visibility {:.3f} ms + flat shading {:.3f} ms)\n",
+    "main pass, no shadows",
+    visibility_ms + unshadowed_ms,
+    visibility_ms,
+    unshadowed_ms);
+
+  const ShadowShading shading {};
+  for (const int resolution : { 512, 1024, 2048 }) {
+    ShadowMap shadow_map(resolution);
+    shadow_map.set_light({ 0.5F, 0.8F, 1.0F });
+    const double plain_ms = time_ms(repeats, [&] { shadow_map.render(mesh, false); });
+    const double early_out_ms = time_ms(repeats, [&] { shadow_map.render(mesh, true); });
+    const double shaded_ms = time_ms(repeats, [&] { shade_shadowed(color_fb, visibility, mesh.vertices, mesh.faces, shadow_map, shading); });
+    const double main_ms = visibility_ms + shaded_ms;
+    std::print("{:<26} {:>10.3f} ms  shadow pass {:.3f} ms ({:.3f} ms without early-out) = {:.0f}% of the main pass "
+               "(visibility {:.3f} ms + {}x{} PCF shading {:.3f} ms), {:.2f} MiB\n",
+      "shadow map " + std::to_string(resolution) + "^2",
+      early_out_ms + main_ms,
+      early_out_ms,
+      plain_ms,
+      100.0 * early_out_ms / main_ms,
+      visibility_ms,
+      (2 * shading.pcf_radius) + 1,
+      (2 * shading.pcf_radius) + 1,
+      shaded_ms,
+      to_mib(shadow_map.memory_bytes()));
+  }
+}
+
+}// namespace
+
+int main(int argc, const char **argv)
+{
+  CLI::App app{ "bloatedrenderer benchmark suite" };
+  std::string model_path = "assets/diablo3_pose.obj";
+  int size = 800;
+  int repeats = 5;
+  app.add_option("-m,--model", model_path, "OBJ model to render, a procedural sphere is used if it cannot be read");
+  app.add_option("-s,--size", size, "framebuffer width and height")->check(CLI::Range(16, 8192));
+  app.add_option("-r,--repeats", repeats, "runs per measurement, the best one is reported")->check(CLI::PositiveNumber);
+  CLI11_PARSE(app, argc, argv);
+
+  OBJObject<float> mesh {};
+  if (!read_obj(model_path, mesh) || mesh.faces.empty()) {
+    std::print("could not read {}, using a procedural sphere\n", model_path);
+    constexpr int sphere_rings = 256;
+    constexpr int sphere_segments = 512;
+    mesh = make_sphere_mesh(sphere_rings, sphere_segments);
+  }
+  OBJObject<float> screen_mesh = mesh;
+  const TGAImage viewport(size, size, TGAImage::GRAYSCALE);
+  screen_mesh.viewport_transform(viewport);
+
+  bench_msaa(screen_mesh, size, repeats);
+  bench_vertex_formats(mesh, size, repeats);
+  bench_meshlets(model_path, mesh, size, repeats);
+  bench_lines(screen_mesh, size, repeats);
+  bench_deferred(screen_mesh, size, repeats);
+  bench_streaming(model_path, mesh, size, repeats);
+  bench_sort_last(screen_mesh, size, repeats);
+  bench_incremental(mesh, size, repeats);
+  bench_shadow(mesh, screen_mesh, size, repeats);
+
+  return 0;
+}
@@ -0,0 +1,331 @@
+#include "compressed_mesh.hpp"
+#include "rasterizer.hpp"
+#include "deferred.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <unordered_map>
+
+namespace {
+
+constexpr float quantization_levels = 65535.0F;
+constexpr float snorm16_max = 32767.0F;
+
+struct CornerKey
+{
+  int vertex = 0;
+  int texture = 0;
+  int normal = 0;
+  bool operator==(const CornerKey &other) const = default;
+};
+
+struct CornerKeyHash
+{
+  std::size_t operator()(const CornerKey &key) const
+  {
+    const std::size_t hash = std::hash<int>{}(key.vertex);
+    const std::size_t texture_hash = std::hash<int>{}(key.texture) * 0x9E3779B97F4A7C15ULL;
+    const std::size_t normal_hash = std::hash<int>{}(key.normal) * 0xC2B2AE3D27D4EB4FULL;
+    return hash ^ texture_hash ^ (normal_hash >> 1U);
+  }
+};
+
+float sign_not_zero(const float value) { return value >= 0.0F ? 1.0F : -1.0F; }
+
+// area weighted normals, used when the OBJ file does not provide any
+std::vector<std::array<float, 3>> compute_vertex_normals(const OBJObject<float> &mesh)
+{
+  std::vector<std::array<float, 3>> normals(mesh.vertices.size(), std::array<float, 3>{});
+  for (const auto &face : mesh.faces) {
+    const auto &vert_a = mesh.vertices.at(static_cast<std::size_t>(face.face_vertices.at(0) - 1));
+    const auto &vert_b = mesh.vertices.at(static_cast<std::size_t>(face.face_vertices.at(1) - 1));
+    const auto &vert_c = mesh.vertices.at(static_cast<std::size_t>(face.face_vertices.at(2) - 1));
+    const std::array<float, 3> edge1 = { vert_b.get_x() - vert_a.get_x(), vert_b.get_y() - vert_a.get_y(), vert_b.get_z() - vert_a.get_z() };
+    const std::array<float, 3> edge2 = { vert_c.get_x() - vert_a.get_x(), vert_c.get_y() - vert_a.get_y(), vert_c.get_z() - vert_a.get_z() };
+    const std::array<float, 3> cross = { (edge1[1] * edge2[2]) - (edge1[2] * edge2[1]),
+      (edge1[2] * edge2[0]) - (edge1[0] * edge2[2]),
+      (edge1[0] * edge2[1]) - (edge1[1] * edge2[0]) };
+    for (const int vertex : face.face_vertices) {
+      auto &normal = normals.at(static_cast<std::size_t>(vertex - 1));
+      for (std::size_t axis = 0; axis < 3; ++axis) { normal.at(axis) += cross.at(axis); }
+    }
+  }
+  return normals;
+}
+
+}// namespace
+
+std::uint16_t float_to_half(const float value)
+{
+  const auto bits = std::bit_cast<std::uint32_t>(value);
+  const std::uint32_t sign = (bits >> 16U) & 0x8000U;
+  const auto biased_exponent = static_cast<int>((bits >> 23U) & 0xFFU);
+  std::uint32_t mantissa = bits & 0x7FFFFFU;
+
+  if (0xFF == biased_exponent) {
+    return static_cast<std::uint16_t>(sign | 0x7C00U | (0 != mantissa ? 0x200U : 0U));
+  }
+  const int exponent = biased_exponent - 127 + 15;
+  if (exponent >= 31) { return static_cast<std::uint16_t>(sign | 0x7C00U); }
+  if (exponent <= 0) {
+    // subnormal half, or zero when even the hidden bit is shifted out
+    if (exponent < -10) { return static_cast<std::uint16_t>(sign); }
+    mantissa |= 0x800000U;
+    const auto shift = static_cast<std::uint32_t>(14 - exponent);
+    std::uint32_t half_mantissa = mantissa >> shift;
+    const std::uint32_t remainder = mantissa & ((1U << shift) - 1U);
+    const std::uint32_t halfway = 1U << (shift - 1U);
+    if (remainder > halfway || (remainder == halfway && static_cast<bool>(half_mantissa & 1U))) { ++half_mantissa; }
+    return static_cast<std::uint16_t>(sign | half_mantissa);
+  }
+  std::uint32_t half = sign | (static_cast<std::uint32_t>(exponent) << 10U) | (mantissa >> 13U);
+  // round to nearest even, a mantissa carry correctly bumps the exponent
+  const std::uint32_t remainder = mantissa & 0x1FFFU;
+  if (remainder > 0x1000U || (remainder == 0x1000U && static_cast<bool>(half & 1U))) { ++half; }
+  return static_cast<std::uint16_t>(half);
+}
+
+float half_to_float(const std::uint16_t half)
+{
+  const std::uint32_t sign = (half & 0x8000U) << 16U;
+  int exponent = (half >> 10U) & 0x1F;
+  std::uint32_t mantissa = half & 0x3FFU;
+
+  std::uint32_t bits = 0;
+  if (0 == exponent) {
+    if (0 == mantissa) {
+      bits = sign;
+    } else {
+      exponent = 1;
+      while (!static_cast<bool>(mantissa & 0x400U)) {
+        mantissa <<= 1U;
+        --exponent;
+      }
+      mantissa &= 0x3FFU;
+      bits = sign | (static_cast<std::uint32_t>(exponent + 127 - 15) << 23U) | (mantissa << 13U);
+    }
+  } else if (0x1F == exponent) {
+    bits = sign | 0x7F800000U | (mantissa << 13U);
+  } else {
+    bits = sign | (static_cast<std::uint32_t>(exponent + 127 - 15) << 23U) | (mantissa << 13U);
+  }
+  return std::bit_cast<float>(bits);
+}
+
+std::array<std::int16_t, 2> encode_octahedral(const std::array<float, 3> &normal)
+{
+  const float l1_norm = std::abs(normal[0]) + std::abs(normal[1]) + std::abs(normal[2]);
+  if (0.0F == l1_norm) { return { 0, 0 }; }
+  float oct_x = normal[0] / l1_norm;
+  float oct_y = normal[1] / l1_norm;
+  if (normal[2] < 0.0F) {
+    const float folded_x = (1.0F - std::abs(oct_y)) * sign_not_zero(oct_x);
+    const float folded_y = (1.0F - std::abs(oct_x)) * sign_not_zero(oct_y);
+    oct_x = folded_x;
+    oct_y = folded_y;
+  }
+  return { static_cast<std::int16_t>(std::round(std::clamp(oct_x, -1.0F, 1.0F) * snorm16_max)),
+    static_cast<std::int16_t>(std::round(std::clamp(oct_y, -1.0F, 1.0F) * snorm16_max)) };
+}
+
+std::array<float, 3> decode_octahedral(const std::array<std::int16_t, 2> &encoded)
+{
+  float oct_x = static_cast<float>(encoded[0]) / snorm16_max;
+  float oct_y = static_cast<float>(encoded[1]) / snorm16_max;
+  const float oct_z = 1.0F - std::abs(oct_x) - std::abs(oct_y);
+  if (oct_z < 0.0F) {
+    const float unfolded_x = (1.0F - std::abs(oct_y)) * sign_not_zero(oct_x);
+    const float unfolded_y = (1.0F - std::abs(oct_x)) * sign_not_zero(oct_y);
+    oct_x = unfolded_x;
+    oct_y = unfolded_y;
+  }
+  const float length = std::sqrt((oct_x * oct_x) + (oct_y * oct_y) + (oct_z * oct_z));
+  if (0.0F == length) { return { 0.0F, 0.0F, 0.0F }; }
+  return { oct_x / length, oct_y / length, oct_z / length };
+}
+
+std::array<std::uint16_t, 3> CompressedMesh::quantize_position(const std::array<float, 3> &position) const
+{
+  std::array<std::uint16_t, 3> quantized {};
+  for (std::size_t axis = 0; axis < 3; ++axis) {
+    if (0.0F == step.at(axis)) { continue; }
+    const float level = std::round((position.at(axis) - bounds_min.at(axis)) / step.at(axis));
+    quantized.at(axis) = static_cast<std::uint16_t>(std::clamp(level, 0.0F, quantization_levels));
+  }
+  return quantized;
+}
+
+std::array<float, 3> CompressedMesh::decode_position(const std::array<std::uint16_t, 3> &quantized) const
+{
+  return { bounds_min[0] + (static_cast<float>(quantized[0]) * step[0]),
+    bounds_min[1] + (static_cast<float>(quantized[1]) * step[1]),
+    bounds_min[2] + (static_cast<float>(quantized[2]) * step[2]) };
+}
+
+std::size_t CompressedMesh::face_count() const
+{
+  std::size_t faces = 0;
+  for (const auto &submesh : submeshes) { faces += submesh.indices.size() / 3; }
+  return faces;
+}
+
+std::size_t CompressedMesh::vertex_count() const
+{
+  std::size_t vertices = 0;
+  for (const auto &submesh : submeshes) { vertices += submesh.positions.size(); }
+  return vertices;
+}
+
+std::size_t CompressedMesh::memory_bytes() const
+{
+  std::size_t bytes = 0;
+  for (const auto &submesh : submeshes) {
+    bytes += (submesh.positions.size() * sizeof(submesh.positions[0])) + (submesh.normals.size() * sizeof(submesh.normals[0]))
+             + (submesh.uvs.size() * sizeof(submesh.uvs[0])) + (submesh.indices.size() * sizeof(std::uint16_t));
+  }
+  return bytes;
+}
+
+std::size_t CompressedMesh::position_bytes() const
+{
+  std::size_t bytes = 0;
+  for (const auto &submesh : submeshes) { bytes += submesh.positions.size() * sizeof(submesh.positions[0]); }
+  return bytes;
+}
+
+CompressedMesh compress_mesh(const OBJObject<float> &mesh, const std::size_t max_submesh_vertices)
+{
+  CompressedMesh compressed {};
+  if (mesh.vertices.empty()) { return compressed; }
+
+  std::array<float, 3> bounds_max {};
+  compressed.bounds_min.fill(std::numeric_limits<float>::max());
+  bounds_max.fill(std::numeric_limits<float>::lowest());
+  for (const auto &vert : mesh.vertices) {
+    for (std::size_t axis = 0; axis < 3; ++axis) {
+      compressed.bounds_min.at(axis) = std::min(compressed.bounds_min.at(axis), vert.vertex_coords.at(axis));
+      bounds_max.at(axis) = std::max(bounds_max.at(axis), vert.vertex_coords.at(axis));
+    }
+  }
+  for (std::size_t axis = 0; axis < 3; ++axis) {
+    compressed.step.at(axis) = (bounds_max.at(axis) - compressed.bounds_min.at(axis)) / quantization_levels;
+  }
+
+  const bool has_normals = !mesh.normals.empty() && !mesh.face_normal_indices.empty();
+  const bool has_uvs = !mesh.texture_coords.empty() && !mesh.face_texture_indices.empty();
+  const std::vector<std::array<float, 3>> generated_normals = has_normals ? std::vector<std::array<float, 3>>{} : compute_vertex_normals(mesh);
+
+  const std::size_t submesh_limit = std::clamp<std::size_t>(max_submesh_vertices, 3, 65536);
+  std::unordered_map<CornerKey, std::uint16_t, CornerKeyHash> remap;
+  compressed.submeshes.emplace_back();
+  for (std::size_t face_index = 0; face_index < mesh.faces.size(); ++face_index) {
+    if (compressed.submeshes.back().positions.size() + 3 > submesh_limit) {
+      compressed.submeshes.emplace_back();
+      remap.clear();
+    }
+    auto &submesh = compressed.submeshes.back();
+    for (std::size_t corner = 0; corner < 3; ++corner) {
+      const CornerKey key{ mesh.faces[face_index].face_vertices.at(corner),
+        has_uvs ? mesh.face_texture_indices[face_index].at(corner) : 0,
+        has_normals ? mesh.face_normal_indices[face_index].at(corner) : 0 };
+      const auto [entry, inserted] = remap.try_emplace(key, static_cast<std::uint16_t>(submesh.positions.size()));
+      if (inserted) {
+        const auto &vert = mesh.vertices.at(static_cast<std::size_t>(key.vertex - 1));
+        submesh.positions.push_back(compressed.quantize_position(vert.vertex_coords));
+
+        std::array<float, 3> normal = generated_normals.empty() ? std::array<float, 3>{} : generated_normals.at(static_cast<std::size_t>(key.vertex - 1));
+        if (has_normals && key.normal > 0) {
+          const auto &file_normal = mesh.normals.at(static_cast<std::size_t>(key.normal - 1));
+          normal = { file_normal.get_x(), file_normal.get_y(), file_normal.get_z() };
+        }
+        submesh.normals.push_back(encode_octahedral(normal));
+
+        std::array<std::uint16_t, 2> uv {};
+        if (has_uvs && key.texture > 0) {
+          const auto &file_uv = mesh.texture_coords.at(static_cast<std::size_t>(key.texture - 1));
+          uv = { float_to_half(file_uv.get_x()), float_to_half(file_uv.get_y()) };
+        }
+        submesh.uvs.push_back(uv);
+      }
+      submesh.indices.push_back(entry->second);
+    }
+  }
+  return compressed;
+}
+
+void transform_submesh(const CompressedMesh &mesh,
+  const CompressedSubmesh &submesh,
+  const TGAImage &viewport,
+  std::span<OBJVertex<float>> screen,
+  std::span<std::array<float, 3>> normals,
+  std::span<std::array<float, 2>> uvs)
+{
+  // decode and viewport transform folded into one multiply-add per axis
+  const auto half_width = static_cast<float>(viewport.width() / 2);
+  const auto half_height = static_cast<float>(viewport.height() / 2);
+  const float half_z = static_cast<float>(UINT8_MAX) / 2;
+  const float scale_x = mesh.step[0] * half_width;
+  const float scale_y = mesh.step[1] * half_height;
+  const float scale_z = mesh.step[2] * half_z;
+  const float offset_x = (mesh.bounds_min[0] + 1.0F) * half_width;
+  const float offset_y = (mesh.bounds_min[1] + 1.0F) * half_height;
+  const float offset_z = (mesh.bounds_min[2] + 1.0F) * half_z;
+
+  for (std::size_t index = 0; index < submesh.positions.size(); ++index) {
+    const auto &quantized = submesh.positions[index];
+    screen[index] = OBJVertex<float>((static_cast<float>(quantized[0]) * scale_x) + offset_x,
+      (static_cast<float>(quantized[1]) * scale_y) + offset_y,
+      std::round((static_cast<float>(quantized[2]) * scale_z) + offset_z));
+  }
+  if (!normals.empty()) {
+    for (std::size_t index = 0; index < submesh.normals.size(); ++index) { normals[index] = decode_octahedral(submesh.normals[index]); }
+  }
+  if (!uvs.empty()) {
+    for (std::size_t index = 0; index < submesh.uvs.size(); ++index) {
+      uvs[index] = { half_to_float(submesh.uvs[index][0]), half_to_float(submesh.uvs[index][1]) };
+    }
+  }
+}
+
+void draw_compressed(TGAImage &img, const CompressedMesh &mesh, TGAImage &zbuffer, FrameArena &arena)
+{
+  constexpr float ambient = 0.2F;
+  std::uint8_t *pixels = img.row(0);
+  std::uint8_t *depth = zbuffer.row(0);
+  const auto bpp = static_cast<std::size_t>(img.bytes_per_pixel());
+  std::size_t face_index = 0;
+  for (const auto &submesh : mesh.submeshes) {
+    const auto screen = arena.allocate<OBJVertex<float>>(submesh.positions.size());
+    const auto normals = arena.allocate<std::array<float, 3>>(submesh.positions.size());
+    transform_submesh(mesh, submesh, img, screen, normals);
+    // the viewport transform does not rotate, so the headlight term is the normal's z
+    const auto intensity = arena.allocate<float>(submesh.positions.size());
+    for (std::size_t index = 0; index < normals.size(); ++index) {
+      intensity[index] = ambient + ((1.0F - ambient) * std::max(0.0F, normals[index][2]));
+    }
+    for (std::size_t index = 0; index + 2 < submesh.indices.size(); index += 3, ++face_index) {
+      const std::array<std::size_t, 3> corners { submesh.indices[index], submesh.indices[index + 1], submesh.indices[index + 2] };
+      const auto corner = [&](const std::size_t vertex) {
+        return std::array { static_cast<int>(screen[vertex].get_x()), static_cast<int>(screen[vertex].get_y()), static_cast<int>(screen[vertex].get_z()) };
+      };
+      const TGAColor base = face_color(face_index);
+      rasterize_triangle(corner(corners[0]), corner(corners[1]), corner(corners[2]), img.width(), img.height(),
+        [&](const std::size_t pixel, const std::uint8_t z_val, const float lam1, const float lam2, const float lam3) {
+          if (depth[pixel] >= z_val) { return; }
+          depth[pixel] = z_val;
+          const float lit = (lam1 * intensity[corners[0]]) + (lam2 * intensity[corners[1]]) + (lam3 * intensity[corners[2]]);
+          TGAColor color = base;
+          for (std::size_t channel = 0; channel < 3; ++channel) {
+            color.bgra[channel] = static_cast<std::uint8_t>(static_cast<float>(color.bgra[channel]) * std::clamp(lit, 0.0F, 1.0F));
+          }
+          std::memcpy(pixels + (pixel * bpp), color.bgra, bpp);
+        });
+    }
+  }
+}
@@ -0,0 +1,65 @@
+#ifndef COMPRESSED_MESH_HPP
+#define COMPRESSED_MESH_HPP
+#include "tgaimage.hpp"
+#include "objreader.hpp"
+#include "frame_memory.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Compact vertex storage for very large meshes. Attributes live in separate streams so each pass of the transform
+// kernel reads only the one it decodes:
+//   position  3 x 16 bit, quantized against the mesh bounding box      (6 bytes instead of 12)
+//   normal    2 x 16 bit snorm, octahedral encoding                     (4 bytes instead of 12)
+//   uv        2 x half float                                            (4 bytes instead of 8)
+//   index     16 bit, local to a sub-mesh of at most 65536 vertices     (2 bytes instead of 4)
+struct CompressedSubmesh
+{
+  std::vector<std::array<std::uint16_t, 3>> positions;
+  std::vector<std::array<std::int16_t, 2>> normals;
+  std::vector<std::array<std::uint16_t, 2>> uvs;
+  std::vector<std::uint16_t> indices;
+};
+
+struct CompressedMesh
+{
+  std::array<float, 3> bounds_min {};
+  // world units per quantization step on each axis
+  std::array<float, 3> step {};
+  std::vector<CompressedSubmesh> submeshes;
+
+  [[nodiscard]] std::array<std::uint16_t, 3> quantize_position(const std::array<float, 3> &position) const;
+  [[nodiscard]] std::array<float, 3> decode_position(const std::array<std::uint16_t, 3> &quantized) const;
+  [[nodiscard]] std::size_t face_count() const;
+  [[nodiscard]] std::size_t vertex_count() const;
+  [[nodiscard]] std::size_t memory_bytes() const;
+  [[nodiscard]] std::size_t position_bytes() const;
+};
+
+std::uint16_t float_to_half(const float value);
+float half_to_float(const std::uint16_t half);
+std::array<std::int16_t, 2> encode_octahedral(const std::array<float, 3> &normal);
+std::array<float, 3> decode_octahedral(const std::array<std::int16_t, 2> &encoded);
+
+// splits the mesh into sub-meshes addressable with 16-bit indices; vertices shared across a split are duplicated.
+// Meshes without normals get area-weighted vertex normals, meshes without texture coordinates get zero uvs.
+CompressedMesh compress_mesh(const OBJObject<float> &mesh, const std::size_t max_submesh_vertices = 65536);
+
+// The transform kernel: decodes positions on the fly straight into the same screen space as
+// OBJObject::viewport_transform. Normals and uvs are decoded alongside when the spans for them are not empty.
+void transform_submesh(const CompressedMesh &mesh,
+  const CompressedSubmesh &submesh,
+  const TGAImage &viewport,
+  std::span<OBJVertex<float>> screen,
+  std::span<std::array<float, 3>> normals = {},
+  std::span<std::array<float, 2>> uvs = {});
+
+// Rasterizes every sub-mesh with the depth test of draw_triangles. Faces are shaded face_color(index) lit by a
+// headlight along +z, with the decoded vertex normals interpolated over the face. Transformed vertices and normals
+// are taken from the frame arena.
+void draw_compressed(TGAImage &img, const CompressedMesh &mesh, TGAImage &zbuffer, FrameArena &arena);
+
+#endif //COMPRESSED_MESH_HPP
@@ -0,0 +1,65 @@
+#include "deferred.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+std::array<std::array<int, 3>, 3> face_corners(std::span<const OBJVertex<float>> vertices, const OBJFaceElements &face)
+{
+  std::array<std::array<int, 3>, 3> corners {};
+  for (std::size_t corner = 0; corner < 3; ++corner) {
+    const auto &vert = face_vertex(vertices, face, corner);
+    corners.at(corner) = { static_cast<int>(vert.get_x()), static_cast<int>(vert.get_y()), static_cast<int>(vert.get_z()) };
+  }
+  return corners;
+}
+
+VisibilityBuffer::VisibilityBuffer(const int width, const int height)
+  : face_ids(static_cast<std::size_t>(width) * static_cast<std::size_t>(height), no_face),
+    barycentrics(face_ids.size()), w(width), h(height)
+{}
+
+void VisibilityBuffer::clear() { std::fill(face_ids.begin(), face_ids.end(), no_face); }
+
+std::size_t VisibilityBuffer::memory_bytes() const
+{
+  return (face_ids.size() * sizeof(std::uint32_t)) + (barycentrics.size() * sizeof(std::array<std::uint16_t, 2>));
+}
+
+void depth_prepass(TGAImage &zbuffer, std::span<const OBJVertex<float>> vertices, std::span<const OBJFaceElements> faces)
+{
+  std::uint8_t *depth = zbuffer.row(0);
+  for (const auto &face : faces) {
+    const auto corners = face_corners(vertices, face);
+    rasterize_triangle(corners[0], corners[1], corners[2], zbuffer.width(), zbuffer.height(),
+      [depth](const std::size_t pixel, const std::uint8_t z_val, float, float, float) {
+        depth[pixel] = std::max(depth[pixel], z_val);
+      });
+  }
+}
+
+void fill_visibility(VisibilityBuffer &visibility,
+  TGAImage &zbuffer,
+  std::span<const OBJVertex<float>> vertices,
+  std::span<const OBJFaceElements> faces)
+{
+  if (zbuffer.width() != visibility.width() || zbuffer.height() != visibility.height()) { return; }
+  std::uint8_t *depth = zbuffer.row(0);
+  constexpr auto unorm_max = static_cast<float>(std::numeric_limits<std::uint16_t>::max());
+  const auto to_unorm = [unorm_max](const float lam) {
+    return static_cast<std::uint16_t>(std::lround(std::clamp(lam, 0.0F, 1.0F) * unorm_max));
+  };
+  for (std::size_t face_index = 0; face_index < faces.size(); ++face_index) {
+    const auto corners = face_corners(vertices, faces[face_index]);
+    const auto face_id = static_cast<std::uint32_t>(face_index);
+    rasterize_triangle(corners[0], corners[1], corners[2], zbuffer.width(), zbuffer.height(),
+      [&](const std::size_t pixel, const std::uint8_t z_val, float, const float lam2, const float lam3) {
+        if (depth[pixel] >= z_val) { return; }
+        depth[pixel] = z_val;
+        visibility.face_ids[pixel] = face_id;
+        visibility.barycentrics[pixel] = { to_unorm(lam2), to_unorm(lam3) };
+      });
+  }
+}
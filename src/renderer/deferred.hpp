@@ -0,0 +1,216 @@
+#ifndef DEFERRED_HPP
+#define DEFERRED_HPP
+#include "tgaimage.hpp"
+#include "objreader.hpp"
+#include "frame_memory.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <span>
+#include <utility>
+#include <vector>
+
+// Two-pass rendering: visibility is resolved first with a depth-only raster loop, then the (expensive) face shader
+// runs once per visible pixel instead of once per fragment that passes the depth test at the time it is drawn.
+// Coverage and depth quantization are exactly those of fill_triangle_zbuffer, so all passes agree with
+// draw_triangles on which face owns a pixel.
+
+// Calls fragment(pixel_index, z, lam1, lam2, lam3) for every pixel inside the clip rectangle (inclusive bounds, within
+// an image `width` pixels wide) covered by the triangle. Edge functions are stepped incrementally in integers;
+// barycentrics and z are then computed like fill_triangle_zbuffer, so results do not depend on the clip rectangle.
+template<typename Fragment>
+void rasterize_triangle_clipped(const std::array<int, 3> &vert_a,
+  const std::array<int, 3> &vert_b,
+  const std::array<int, 3> &vert_c,
+  const int width,
+  const std::array<int, 4> &clip,
+  Fragment &&fragment)
+{
+  const auto [ax, ay, az] = vert_a;
+  const auto [bx, by, bz] = vert_b;
+  const auto [cx, cy, cz] = vert_c;
+  // twice the signed areas of s_triangle_area
+  const auto edge = [](const int px, const int py, const int qx, const int qy, const int rx, const int ry) {
+    return ((px - rx) * (qy - py)) - ((px - qx) * (ry - py));
+  };
+  const int total = edge(ax, ay, bx, by, cx, cy);
+  if (0 == total) { return; }
+  const auto total_f = static_cast<float>(total);
+
+  const int x_min = std::max(clip[0], std::min({ ax, bx, cx }));
+  const int y_min = std::max(clip[1], std::min({ ay, by, cy }));
+  const int x_max = std::min(clip[2], std::max({ ax, bx, cx }));
+  const int y_max = std::min(clip[3], std::max({ ay, by, cy }));
+  if (x_min > x_max || y_min > y_max) { return; }
+
+  // the edge functions are linear in x, so a row is walked with one add per edge
+  const int step1 = by - cy;
+  const int step2 = cy - ay;
+  const int step3 = ay - by;
+  for (int j = y_min; j <= y_max; ++j) {
+    int edge1 = edge(x_min, j, bx, by, cx, cy);
+    int edge2 = edge(ax, ay, x_min, j, cx, cy);
+    int edge3 = edge(ax, ay, bx, by, x_min, j);
+    std::size_t pixel = (static_cast<std::size_t>(j) * static_cast<std::size_t>(width)) + static_cast<std::size_t>(x_min);
+    for (int i = x_min; i <= x_max; ++i, ++pixel, edge1 += step1, edge2 += step2, edge3 += step3) {
+      const bool inside = total > 0 ? (edge1 >= 0 && edge2 >= 0 && edge3 >= 0) : (edge1 <= 0 && edge2 <= 0 && edge3 <= 0);
+      if (!inside) { continue; }
+      const float lam1 = static_cast<float>(edge1) / total_f;
+      const float lam2 = static_cast<float>(edge2) / total_f;
+      const float lam3 = static_cast<float>(edge3) / total_f;
+      const auto z_val = static_cast<std::uint8_t>((lam1 * static_cast<float>(az)) + (lam2 * static_cast<float>(bz)) + (lam3 * static_cast<float>(cz)));
+      fragment(pixel, z_val, lam1, lam2, lam3);
+    }
+  }
+}
+
+// the whole image as clip rectangle
+template<typename Fragment>
+void rasterize_triangle(const std::array<int, 3> &vert_a,
+  const std::array<int, 3> &vert_b,
+  const std::array<int, 3> &vert_c,
+  const int width,
+  const int height,
+  Fragment &&fragment)
+{
+  rasterize_triangle_clipped(vert_a, vert_b, vert_c, width, { 0, 0, width - 1, height - 1 }, std::forward<Fragment>(fragment));
+}
+
+// screen space corners of a face, truncated like draw_triangles does; std::out_of_range for an undefined vertex
+std::array<std::array<int, 3>, 3> face_corners(std::span<const OBJVertex<float>> vertices, const OBJFaceElements &face);
+
+// G-buffer of the deferred path: the face that owns each pixel and the pixel's barycentrics in it (lam2 and lam3 as
+// 16 bit unorm, lam1 = 1 - lam2 - lam3). 8 bytes per pixel.
+struct VisibilityBuffer
+{
+  static constexpr std::uint32_t no_face = std::numeric_limits<std::uint32_t>::max();
+
+  VisibilityBuffer() = default;
+  VisibilityBuffer(const int width, const int height);
+
+  void clear();
+  [[nodiscard]] int width() const { return w; }
+  [[nodiscard]] int height() const { return h; }
+  [[nodiscard]] std::size_t memory_bytes() const;
+
+  std::vector<std::uint32_t> face_ids;
+  std::vector<std::array<std::uint16_t, 2>> barycentrics;
+
+private:
+  int w = 0;
+  int h = 0;
+};
+
+// depth-only pass: no colour, no shading, only the z-buffer is written
+void depth_prepass(TGAImage &zbuffer, std::span<const OBJVertex<float>> vertices, std::span<const OBJFaceElements> faces);
+
+// depth pass that also records the winning face and barycentrics per pixel
+void fill_visibility(VisibilityBuffer &visibility,
+  TGAImage &zbuffer,
+  std::span<const OBJVertex<float>> vertices,
+  std::span<const OBJFaceElements> faces);
+
+// Reference single-pass path on raw width x height buffers, colour with bpp bytes per pixel and one depth byte per
+// pixel: like draw_triangles, the shader runs for every fragment that passes the depth test when it is drawn.
+// Returns the number of shader invocations.
+template<typename FaceShader>
+std::size_t shade_forward(std::uint8_t *pixels,
+  std::uint8_t *depth,
+  const int width,
+  const int height,
+  const std::size_t bpp,
+  std::span<const OBJVertex<float>> vertices,
+  std::span<const OBJFaceElements> faces,
+  FaceShader &&face_shader)
+{
+  std::size_t invocations = 0;
+  for (std::size_t face_index = 0; face_index < faces.size(); ++face_index) {
+    const auto corners = face_corners(vertices, faces[face_index]);
+    rasterize_triangle(corners[0], corners[1], corners[2], width, height,
+      [&](const std::size_t pixel, const std::uint8_t z_val, const float lam1, const float lam2, const float lam3) {
+        if (depth[pixel] >= z_val) { return; }
+        depth[pixel] = z_val;
+        const TGAColor color = face_shader(face_index, lam1, lam2, lam3);
+        std::memcpy(pixels + (pixel * bpp), color.bgra, bpp);
+        ++invocations;
+      });
+  }
+  return invocations;
+}
+
+template<typename FaceShader>
+std::size_t shade_forward(TGAImage &img,
+  TGAImage &zbuffer,
+  std::span<const OBJVertex<float>> vertices,
+  std::span<const OBJFaceElements> faces,
+  FaceShader &&face_shader)
+{
+  return shade_forward(img.row(0),
+    zbuffer.row(0),
+    img.width(),
+    img.height(),
+    static_cast<std::size_t>(img.bytes_per_pixel()),
+    vertices,
+    faces,
+    std::forward<FaceShader>(face_shader));
+}
+
+// Equal-depth pass over a z-buffer filled by depth_prepass: the first face in draw order that reaches the stored depth
+// is shaded, which is the face the forward path keeps. The per-pixel mask comes from the frame arena and stays
+// allocated until its next reset(). Returns the number of shader invocations.
+template<typename FaceShader>
+std::size_t shade_equal_depth(TGAImage &img,
+  const TGAImage &zbuffer,
+  std::span<const OBJVertex<float>> vertices,
+  std::span<const OBJFaceElements> faces,
+  FrameArena &arena,
+  FaceShader &&face_shader)
+{
+  std::uint8_t *pixels = img.row(0);
+  const std::uint8_t *depth = zbuffer.row(0);
+  const auto bpp = static_cast<std::size_t>(img.bytes_per_pixel());
+  // 8 bit depth ties are common, so shaded pixels are masked like a stencil
+  const auto shaded = arena.allocate<std::uint8_t>(static_cast<std::size_t>(img.width()) * static_cast<std::size_t>(img.height()));
+  std::fill(shaded.begin(), shaded.end(), std::uint8_t { 0 });
+  std::size_t invocations = 0;
+  for (std::size_t face_index = 0; face_index < faces.size(); ++face_index) {
+    const auto corners = face_corners(vertices, faces[face_index]);
+    rasterize_triangle(corners[0], corners[1], corners[2], img.width(), img.height(),
+      [&](const std::size_t pixel, const std::uint8_t z_val, const float lam1, const float lam2, const float lam3) {
+        if (0 == z_val || depth[pixel] != z_val || 0 != shaded[pixel]) { return; }
+        shaded[pixel] = 1;
+        const TGAColor color = face_shader(face_index, lam1, lam2, lam3);
+        std::memcpy(pixels + (pixel * bpp), color.bgra, bpp);
+        ++invocations;
+      });
+  }
+  return invocations;
+}
+
+// Resolves a visibility buffer: one shader invocation per covered pixel, no rasterization. Returns the number of
+// shader invocations.
+template<typename FaceShader>
+std::size_t shade_visibility(TGAImage &img, const VisibilityBuffer &visibility, FaceShader &&face_shader)
+{
+  if (img.width() != visibility.width() || img.height() != visibility.height()) { return 0; }
+  std::uint8_t *pixels = img.row(0);
+  const auto bpp = static_cast<std::size_t>(img.bytes_per_pixel());
+  constexpr float unorm_scale = 1.0F / static_cast<float>(std::numeric_limits<std::uint16_t>::max());
+  std::size_t invocations = 0;
+  for (std::size_t pixel = 0; pixel < visibility.face_ids.size(); ++pixel) {
+    const std::uint32_t face_index = visibility.face_ids[pixel];
+    if (VisibilityBuffer::no_face == face_index) { continue; }
+    const float lam2 = static_cast<float>(visibility.barycentrics[pixel][0]) * unorm_scale;
+    const float lam3 = static_cast<float>(visibility.barycentrics[pixel][1]) * unorm_scale;
+    const TGAColor color = face_shader(static_cast<std::size_t>(face_index), 1.0F - lam2 - lam3, lam2, lam3);
+    std::memcpy(pixels + (pixel * bpp), color.bgra, bpp);
+    ++invocations;
+  }
+  return invocations;
+}
+
+#endif //DEFERRED_HPP
@@ -0,0 +1,58 @@
+#include "frame_memory.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+
+FrameArena::FrameArena(const std::size_t initial_bytes)
+  : block(initial_bytes > 0 ? std::make_unique<std::byte[]>(initial_bytes) : nullptr), block_size(initial_bytes)
+{}
+
+std::byte *FrameArena::allocate_bytes(const std::size_t bytes, const std::size_t alignment)
+{
+  const std::size_t aligned_offset = (offset + alignment - 1) & ~(alignment - 1);
+  std::byte *memory = nullptr;
+  if (aligned_offset + bytes <= block_size) {
+    offset = aligned_offset + bytes;
+    memory = block.get() + aligned_offset;
+  } else {
+    // does not fit: serve from the heap for this frame only, reset() grows the block
+    overflow_bytes += bytes + alignment;
+    overflow.push_back(std::make_unique_for_overwrite<std::byte[]>(bytes));
+    memory = overflow.back().get();
+  }
+  used_bytes = offset + overflow_bytes;
+  high_water_bytes = std::max(high_water_bytes, used_bytes);
+  return memory;
+}
+
+void FrameArena::reset()
+{
+  if (!overflow.empty()) {
+    overflow.clear();
+    block_size = high_water_bytes;
+    block = std::make_unique_for_overwrite<std::byte[]>(block_size);
+  }
+  offset = 0;
+  overflow_bytes = 0;
+  used_bytes = 0;
+}
+
+TGAImage &ImagePool::acquire(const int width, const int height, const int bpp, const TGAColor &clear_color)
+{
+  const auto reusable = std::find_if(entries.begin(), entries.end(), [&](const Entry &entry) {
+    return !entry.in_use && entry.width == width && entry.height == height && entry.bpp == bpp;
+  });
+  if (reusable != entries.end()) {
+    reusable->in_use = true;
+    reusable->image.clear(clear_color);
+    return reusable->image;
+  }
+  entries.push_back({ TGAImage(width, height, bpp, clear_color), width, height, bpp, true });
+  return entries.back().image;
+}
+
+void ImagePool::reset()
+{
+  for (auto &entry : entries) { entry.in_use = false; }
+}
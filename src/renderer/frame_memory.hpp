@@ -0,0 +1,110 @@
+#ifndef FRAME_MEMORY_HPP
+#define FRAME_MEMORY_HPP
+#include "tgaimage.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <new>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+// Linear allocator for per-frame scratch data. Allocations are only valid until reset(). When a frame overflows
+// the block, the overflow is served from the heap and the next reset() grows the block to the high-water mark,
+// so after the first few frames a steady workload never touches the heap again.
+class FrameArena
+{
+public:
+  FrameArena() = default;
+  explicit FrameArena(const std::size_t initial_bytes);
+
+  template<typename T> [[nodiscard]] std::span<T> allocate(const std::size_t count);
+  void reset();
+
+  [[nodiscard]] std::size_t used() const { return used_bytes; }
+  [[nodiscard]] std::size_t capacity() const { return block_size; }
+  [[nodiscard]] std::size_t high_water() const { return high_water_bytes; }
+
+private:
+  [[nodiscard]] std::byte *allocate_bytes(const std::size_t bytes, const std::size_t alignment);
+
+  std::unique_ptr<std::byte[]> block;
+  std::size_t block_size = 0;
+  std::size_t offset = 0;
+  std::size_t overflow_bytes = 0;
+  std::size_t used_bytes = 0;
+  std::size_t high_water_bytes = 0;
+  std::vector<std::unique_ptr<std::byte[]>> overflow;
+};
+
+template<typename T> std::span<T> FrameArena::allocate(const std::size_t count)
+{
+  static_assert(std::is_trivially_destructible_v<T>, "arena memory is released without running destructors");
+  static_assert(alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__, "over-aligned types are not supported");
+  if (0 == count) { return {}; }
+  T *first = reinterpret_cast<T *>(allocate_bytes(count * sizeof(T), alignof(T)));
+  std::uninitialized_default_construct_n(first, count);
+  return { first, count };
+}
+
+// Images handed out by acquire() stay valid and untouched by other acquires until reset(); after that they are
+// recycled for the next request with the same size and format.
+class ImagePool
+{
+public:
+  TGAImage &acquire(const int width, const int height, const int bpp, const TGAColor &clear_color = {});
+  void reset();
+
+  [[nodiscard]] std::size_t size() const { return entries.size(); }
+
+private:
+  struct Entry
+  {
+    TGAImage image;
+    int width = 0;
+    int height = 0;
+    int bpp = 0;
+    bool in_use = false;
+  };
+  std::deque<Entry> entries;
+};
+
+// Hands out empty vectors that keep the capacity they grew to in earlier frames.
+template<typename T> class VectorPool
+{
+public:
+  std::vector<T> &acquire()
+  {
+    if (in_use == vectors.size()) { vectors.emplace_back(); }
+    auto &vec = vectors[in_use++];
+    vec.clear();
+    return vec;
+  }
+  void reset() { in_use = 0; }
+
+  [[nodiscard]] std::size_t size() const { return vectors.size(); }
+
+private:
+  std::deque<std::vector<T>> vectors;
+  std::size_t in_use = 0;
+};
+
+// Everything a frame needs for scratch storage; call reset() once the frame has been emitted.
+struct FrameResources
+{
+  FrameArena arena;
+  ImagePool images;
+  // byte scratch such as encoded output files
+  VectorPool<std::uint8_t> byte_buffers;
+
+  void reset()
+  {
+    arena.reset();
+    images.reset();
+    byte_buffers.reset();
+  }
+};
+
+#endif //FRAME_MEMORY_HPP
@@ -0,0 +1,237 @@
+#include "incremental.hpp"
+#include "deferred.hpp"
+#include "rasterizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <utility>
+
+IncrementalRenderer::IncrementalRenderer(const int width, const int height, const int tile_size, const int bytes_per_pixel)
+  : color_buffer(width, height, bytes_per_pixel), depth_buffer(width, height, TGAImage::GRAYSCALE),
+    tile(std::max(1, tile_size)), tiles_x((width + tile - 1) / tile), tiles_y((height + tile - 1) / tile),
+    dirty(static_cast<std::size_t>(tiles_x) * static_cast<std::size_t>(tiles_y), 1)
+{}
+
+std::size_t IncrementalRenderer::add_object(const OBJObject<float> &mesh, const ObjectPlacement &placement)
+{
+  Object object {};
+  object.mesh = &mesh;
+  object.placement = placement;
+  object.first_face = face_total;
+  face_total += mesh.faces.size();
+  objects.push_back(std::move(object));
+  return objects.size() - 1;
+}
+
+void IncrementalRenderer::set_placement(const std::size_t object, const ObjectPlacement &placement)
+{
+  Object &target = objects[object];
+  const ObjectPlacement &old = target.placement;
+  if (old.offset == placement.offset && old.scale == placement.scale && old.visible == placement.visible) { return; }
+  target.placement = placement;
+  target.changed = true;
+}
+
+void IncrementalRenderer::invalidate(const std::size_t object) { objects[object].changed = true; }
+
+void IncrementalRenderer::invalidate_all() { std::ranges::fill(dirty, std::uint8_t { 1 }); }
+
+// viewport_transform of the placed mesh; depth is clamped so that 8 bit depths stay valid for any placement
+void IncrementalRenderer::update_object(Object &object)
+{
+  const float half_width = static_cast<float>(color_buffer.width() / 2);
+  const float half_height = static_cast<float>(color_buffer.height() / 2);
+  const float half_z = static_cast<float>(UINT8_MAX) / 2;
+  const auto &[offset, scale, visible] = object.placement;
+  object.screen_vertices.resize(object.mesh->vertices.size());
+  object.bounds = {};
+  if (!visible || object.mesh->vertices.empty()) { return; }
+
+  std::array<float, 2> low { std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
+  std::array<float, 2> high { std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest() };
+  for (std::size_t index = 0; index < object.screen_vertices.size(); ++index) {
+    const auto &vert = object.mesh->vertices[index];
+    const float x_val = ((vert.get_x() * scale) + offset[0] + 1.0F) * half_width;
+    const float y_val = ((vert.get_y() * scale) + offset[1] + 1.0F) * half_height;
+    const float z_val = std::clamp(std::round(((vert.get_z() * scale) + offset[2] + 1.0F) * half_z), 0.0F, half_z * 2);
+    object.screen_vertices[index] = OBJVertex<float>(x_val, y_val, z_val);
+    low = { std::min(low[0], x_val), std::min(low[1], y_val) };
+    high = { std::max(high[0], x_val), std::max(high[1], y_val) };
+  }
+  // face_corners truncates, which is monotonic, so the truncated extremes bound every face
+  const auto truncate = [](const float value, const int limit) {
+    return static_cast<int>(std::clamp(value, -1.0F, static_cast<float>(limit)));
+  };
+  object.bounds = { std::max(0, truncate(low[0], color_buffer.width())),
+    std::max(0, truncate(low[1], color_buffer.height())),
+    std::min(color_buffer.width() - 1, truncate(high[0], color_buffer.width())),
+    std::min(color_buffer.height() - 1, truncate(high[1], color_buffer.height())) };
+}
+
+void IncrementalRenderer::mark_dirty(const ScreenRect &rect)
+{
+  if (rect.empty()) { return; }
+  for (int tile_y = rect.y_min / tile; tile_y <= rect.y_max / tile; ++tile_y) {
+    for (int tile_x = rect.x_min / tile; tile_x <= rect.x_max / tile; ++tile_x) {
+      dirty[(static_cast<std::size_t>(tile_y) * static_cast<std::size_t>(tiles_x)) + static_cast<std::size_t>(tile_x)] = 1;
+    }
+  }
+}
+
+bool IncrementalRenderer::any_dirty(const ScreenRect &rect) const
+{
+  if (rect.empty()) { return false; }
+  for (int tile_y = rect.y_min / tile; tile_y <= rect.y_max / tile; ++tile_y) {
+    for (int tile_x = rect.x_min / tile; tile_x <= rect.x_max / tile; ++tile_x) {
+      if (0 != dirty[(static_cast<std::size_t>(tile_y) * static_cast<std::size_t>(tiles_x)) + static_cast<std::size_t>(tile_x)]) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+ScreenRect IncrementalRenderer::tile_rect(const int tile_x, const int tile_y) const
+{
+  return { tile_x * tile,
+    tile_y * tile,
+    std::min(color_buffer.width(), (tile_x + 1) * tile) - 1,
+    std::min(color_buffer.height(), (tile_y + 1) * tile) - 1 };
+}
+
+void IncrementalRenderer::clear_tile(const int tile_x, const int tile_y)
+{
+  const ScreenRect rect = tile_rect(tile_x, tile_y);
+  const auto bpp = static_cast<std::size_t>(color_buffer.bytes_per_pixel());
+  const auto columns = static_cast<std::size_t>(rect.width());
+  for (int y = rect.y_min; y <= rect.y_max; ++y) {
+    std::memset(color_buffer.row(y) + (static_cast<std::size_t>(rect.x_min) * bpp), 0, columns * bpp);
+    std::memset(depth_buffer.row(y) + rect.x_min, 0, columns);
+  }
+}
+
+std::size_t IncrementalRenderer::draw_object(const Object &object)
+{
+  std::uint8_t *pixels = color_buffer.row(0);
+  std::uint8_t *depth = depth_buffer.row(0);
+  const auto bpp = static_cast<std::size_t>(color_buffer.bytes_per_pixel());
+  const int width = color_buffer.width();
+  const int height = color_buffer.height();
+  std::size_t faces_drawn = 0;
+  for (std::size_t face_index = 0; face_index < object.mesh->faces.size(); ++face_index) {
+    const auto corners = face_corners(object.screen_vertices, object.mesh->faces[face_index]);
+    const ScreenRect face_bounds { std::max(0, std::min({ corners[0][0], corners[1][0], corners[2][0] })),
+      std::max(0, std::min({ corners[0][1], corners[1][1], corners[2][1] })),
+      std::min(width - 1, std::max({ corners[0][0], corners[1][0], corners[2][0] })),
+      std::min(height - 1, std::max({ corners[0][1], corners[1][1], corners[2][1] })) };
+    if (face_bounds.empty()) { continue; }
+    const TGAColor color = face_color(object.first_face + face_index);
+    bool drawn = false;
+    // clipping to each dirty tile visits the same pixels in the same order as an unclipped draw restricted to them
+    for (int tile_y = face_bounds.y_min / tile; tile_y <= face_bounds.y_max / tile; ++tile_y) {
+      for (int tile_x = face_bounds.x_min / tile; tile_x <= face_bounds.x_max / tile; ++tile_x) {
+        if (0 == dirty[(static_cast<std::size_t>(tile_y) * static_cast<std::size_t>(tiles_x)) + static_cast<std::size_t>(tile_x)]) {
+          continue;
+        }
+        const ScreenRect clip = tile_rect(tile_x, tile_y);
+        rasterize_triangle_clipped(corners[0], corners[1], corners[2], width, { clip.x_min, clip.y_min, clip.x_max, clip.y_max },
+          [&](const std::size_t pixel, const std::uint8_t z_val, float, float, float) {
+            if (depth[pixel] >= z_val) { return; }
+            depth[pixel] = z_val;
+            std::memcpy(pixels + (pixel * bpp), color.bgra, bpp);
+          });
+        drawn = true;
+      }
+    }
+    if (drawn) { ++faces_drawn; }
+  }
+  return faces_drawn;
+}
+
+// runs of dirty tiles per tile row, joined with the run directly above when it spans the same columns
+void IncrementalRenderer::merge_regions(std::vector<ScreenRect> &regions) const
+{
+  regions.clear();
+  std::size_t previous_row_begin = 0;
+  for (int tile_y = 0; tile_y < tiles_y; ++tile_y) {
+    const std::size_t row_begin = regions.size();
+    int tile_x = 0;
+    while (tile_x < tiles_x) {
+      const auto is_dirty = [&](const int column) {
+        return 0 != dirty[(static_cast<std::size_t>(tile_y) * static_cast<std::size_t>(tiles_x)) + static_cast<std::size_t>(column)];
+      };
+      if (!is_dirty(tile_x)) {
+        ++tile_x;
+        continue;
+      }
+      const int run_begin = tile_x;
+      while (tile_x < tiles_x && is_dirty(tile_x)) { ++tile_x; }
+      const ScreenRect run { tile_rect(run_begin, tile_y).x_min, tile_rect(run_begin, tile_y).y_min,
+        tile_rect(tile_x - 1, tile_y).x_max, tile_rect(tile_x - 1, tile_y).y_max };
+      const auto above = std::find_if(regions.begin() + static_cast<std::ptrdiff_t>(previous_row_begin),
+        regions.begin() + static_cast<std::ptrdiff_t>(row_begin),
+        [&](const ScreenRect &rect) { return rect.x_min == run.x_min && rect.x_max == run.x_max && rect.y_max + 1 == run.y_min; });
+      if (above != regions.begin() + static_cast<std::ptrdiff_t>(row_begin)) {
+        above->y_max = run.y_max;
+      } else {
+        regions.push_back(run);
+      }
+    }
+    // extended rectangles stay open for the next row, the others are complete
+    const auto open_begin = std::stable_partition(regions.begin() + static_cast<std::ptrdiff_t>(previous_row_begin),
+      regions.end(),
+      [&](const ScreenRect &rect) { return rect.y_max < tile_rect(0, tile_y).y_min; });
+    previous_row_begin = static_cast<std::size_t>(open_begin - regions.begin());
+  }
+}
+
+IncrementalStats IncrementalRenderer::render_frame()
+{
+  for (Object &object : objects) {
+    if (!object.changed) { continue; }
+    mark_dirty(object.bounds);
+    update_object(object);
+    mark_dirty(object.bounds);
+    object.changed = false;
+  }
+
+  IncrementalStats stats {};
+  stats.total_tiles = dirty.size();
+  stats.dirty_tiles = static_cast<std::size_t>(std::ranges::count(dirty, std::uint8_t { 1 }));
+  if (0 == stats.dirty_tiles) { return stats; }
+
+  for (int tile_y = 0; tile_y < tiles_y; ++tile_y) {
+    for (int tile_x = 0; tile_x < tiles_x; ++tile_x) {
+      if (0 != dirty[(static_cast<std::size_t>(tile_y) * static_cast<std::size_t>(tiles_x)) + static_cast<std::size_t>(tile_x)]) {
+        clear_tile(tile_x, tile_y);
+      }
+    }
+  }
+  for (const Object &object : objects) {
+    if (!object.placement.visible || !any_dirty(object.bounds)) { continue; }
+    ++stats.objects_drawn;
+    stats.faces_drawn += draw_object(object);
+  }
+  merge_regions(stats.regions);
+  std::ranges::fill(dirty, std::uint8_t { 0 });
+  return stats;
+}
+
+TGAImage extract_region(const TGAImage &img, const ScreenRect &rect)
+{
+  const ScreenRect clipped { std::max(0, rect.x_min),
+    std::max(0, rect.y_min),
+    std::min(img.width() - 1, rect.x_max),
+    std::min(img.height() - 1, rect.y_max) };
+  if (clipped.empty()) { return {}; }
+  TGAImage region(clipped.width(), clipped.height(), img.bytes_per_pixel());
+  const auto bpp = static_cast<std::size_t>(img.bytes_per_pixel());
+  for (int y = clipped.y_min; y <= clipped.y_max; ++y) {
+    std::memcpy(region.row(y - clipped.y_min),
+      img.row(y) + (static_cast<std::size_t>(clipped.x_min) * bpp),
+      static_cast<std::size_t>(clipped.width()) * bpp);
+  }
+  return region;
+}
@@ -0,0 +1,109 @@
+#ifndef INCREMENTAL_HPP
+#define INCREMENTAL_HPP
+#include "tgaimage.hpp"
+#include "objreader.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Incremental rendering for animated scenes: the frame is split into square tiles and the renderer keeps the screen
+// space bounds of every object between frames. When objects move, only the tiles under their old and new bounds are
+// cleared and re-rasterized, with the geometry of every object that overlaps them clipped to those tiles. Objects are
+// drawn in the order they were added and faces are shaded with face_color(index in the concatenated face lists), so
+// every frame is identical to a full redraw of the scene with shade_forward.
+
+// inclusive pixel bounds, empty when x_min > x_max or y_min > y_max
+struct ScreenRect
+{
+  int x_min = 0;
+  int y_min = 0;
+  int x_max = -1;
+  int y_max = -1;
+
+  [[nodiscard]] bool empty() const { return x_min > x_max || y_min > y_max; }
+  [[nodiscard]] int width() const { return empty() ? 0 : x_max - x_min + 1; }
+  [[nodiscard]] int height() const { return empty() ? 0 : y_max - y_min + 1; }
+};
+
+// placement of a mesh given in normalized device coordinates: p * scale + offset
+struct ObjectPlacement
+{
+  std::array<float, 3> offset {};
+  float scale = 1.0F;
+  bool visible = true;
+};
+
+struct IncrementalStats
+{
+  std::size_t dirty_tiles = 0;
+  std::size_t total_tiles = 0;
+  // objects and faces that overlapped at least one dirty tile
+  std::size_t objects_drawn = 0;
+  std::size_t faces_drawn = 0;
+  // the dirty tiles merged into rectangles; what has to be sent for a partial frame update
+  std::vector<ScreenRect> regions;
+
+  [[nodiscard]] double dirty_fraction() const
+  {
+    return 0 == total_tiles ? 0.0 : static_cast<double>(dirty_tiles) / static_cast<double>(total_tiles);
+  }
+};
+
+class IncrementalRenderer
+{
+public:
+  IncrementalRenderer(const int width, const int height, const int tile_size = 32, const int bytes_per_pixel = TGAImage::RGB);
+
+  // the mesh must outlive the renderer; returns the object id
+  std::size_t add_object(const OBJObject<float> &mesh, const ObjectPlacement &placement = {});
+  void set_placement(const std::size_t object, const ObjectPlacement &placement);
+  // the object's mesh was modified in place
+  void invalidate(const std::size_t object);
+  // the next frame is redrawn completely
+  void invalidate_all();
+
+  // clears and re-rasterizes the dirty tiles; the first frame is fully dirty
+  IncrementalStats render_frame();
+
+  [[nodiscard]] const TGAImage &color() const { return color_buffer; }
+  [[nodiscard]] const TGAImage &depth() const { return depth_buffer; }
+  [[nodiscard]] int tile_size() const { return tile; }
+  [[nodiscard]] std::size_t object_count() const { return objects.size(); }
+  // screen bounds of the object as of the last frame
+  [[nodiscard]] ScreenRect bounds(const std::size_t object) const { return objects[object].bounds; }
+
+private:
+  struct Object
+  {
+    const OBJObject<float> *mesh = nullptr;
+    ObjectPlacement placement {};
+    std::size_t first_face = 0;
+    std::vector<OBJVertex<float>> screen_vertices;
+    ScreenRect bounds {};
+    bool changed = true;
+  };
+
+  void update_object(Object &object);
+  void mark_dirty(const ScreenRect &rect);
+  [[nodiscard]] bool any_dirty(const ScreenRect &rect) const;
+  [[nodiscard]] ScreenRect tile_rect(const int tile_x, const int tile_y) const;
+  void clear_tile(const int tile_x, const int tile_y);
+  std::size_t draw_object(const Object &object);
+  void merge_regions(std::vector<ScreenRect> &regions) const;
+
+  TGAImage color_buffer;
+  TGAImage depth_buffer;
+  int tile = 32;
+  int tiles_x = 0;
+  int tiles_y = 0;
+  std::vector<std::uint8_t> dirty;
+  std::vector<Object> objects;
+  std::size_t face_total = 0;
+};
+
+// copies a region of an image, e.g. to write only the part of a frame that changed
+TGAImage extract_region(const TGAImage &img, const ScreenRect &rect);
+
+#endif //INCREMENTAL_HPP
@@ -0,0 +1,186 @@
+#include "lines.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+// Bresenham over pixel indices, so the same stepping serves the colour rows (Bpp bytes per pixel) and the one byte
+// per pixel z-buffer. The line must already be clipped.
+template<int Bpp, bool DepthTest>
+void plot_line(std::uint8_t *pixels,
+  const std::uint8_t *depth,
+  const std::ptrdiff_t width,
+  const LineSegment &line,
+  const TGAColor &color,
+  const int depth_bias)
+{
+  const int delta_x = std::abs(line.x1 - line.x0);
+  const int delta_y = std::abs(line.y1 - line.y0);
+  const std::ptrdiff_t step_x = line.x1 >= line.x0 ? 1 : -1;
+  const std::ptrdiff_t step_y = line.y1 >= line.y0 ? width : -width;
+  const bool x_major = delta_x >= delta_y;
+  const int major = x_major ? delta_x : delta_y;
+  const int minor = x_major ? delta_y : delta_x;
+  const std::ptrdiff_t major_step = x_major ? step_x : step_y;
+  const std::ptrdiff_t minor_step = x_major ? step_y : step_x;
+
+  // 16.16 fixed point depth
+  constexpr int depth_shift = 16;
+  int depth_fixed = (line.z0 * (1 << depth_shift)) + (1 << (depth_shift - 1));
+  const int depth_step = major > 0 ? ((line.z1 - line.z0) * (1 << depth_shift)) / major : 0;
+
+  std::ptrdiff_t pixel = (static_cast<std::ptrdiff_t>(line.y0) * width) + line.x0;
+  int error = major / 2;
+  for (int step = 0; step <= major; ++step) {
+    if constexpr (DepthTest) {
+      if (static_cast<int>(depth[pixel]) <= (depth_fixed >> depth_shift) + depth_bias) {
+        std::memcpy(pixels + (pixel * Bpp), color.bgra, Bpp);
+      }
+      depth_fixed += depth_step;
+    } else {
+      std::memcpy(pixels + (pixel * Bpp), color.bgra, Bpp);
+    }
+    error -= minor;
+    if (error < 0) {
+      error += major;
+      pixel += minor_step;
+    }
+    pixel += major_step;
+  }
+}
+
+template<bool DepthTest>
+void draw_lines_impl(TGAImage &img,
+  const TGAImage *zbuffer,
+  std::span<const LineSegment> lines,
+  const TGAColor &color,
+  const int depth_bias)
+{
+  const int width = img.width();
+  const int height = img.height();
+  if (width <= 0 || height <= 0) { return; }
+  std::uint8_t *pixels = img.row(0);
+  const std::uint8_t *depth = DepthTest ? zbuffer->row(0) : nullptr;
+
+  const auto plot_all = [&]<int Bpp>() {
+    for (LineSegment line : lines) {
+      if (!clip_line(line, width, height)) { continue; }
+      plot_line<Bpp, DepthTest>(pixels, depth, width, line, color, depth_bias);
+    }
+  };
+  switch (img.bytes_per_pixel()) {
+  case TGAImage::GRAYSCALE:
+    plot_all.template operator()<TGAImage::GRAYSCALE>();
+    break;
+  case TGAImage::RGB:
+    plot_all.template operator()<TGAImage::RGB>();
+    break;
+  case TGAImage::RGBA:
+    plot_all.template operator()<TGAImage::RGBA>();
+    break;
+  default:
+    break;
+  }
+}
+
+}// namespace
+
+bool clip_line(LineSegment &line, const int width, const int height)
+{
+  if (width <= 0 || height <= 0) { return false; }
+  const auto x_max = static_cast<double>(width - 1);
+  const auto y_max = static_cast<double>(height - 1);
+
+  // Liang-Barsky: the parameter range [t_enter, t_leave] of the segment that lies within the pixel squares, i.e. half
+  // a pixel beyond the pixel centres on every side. Computed in floating point from the original segment, so no
+  // rounded intermediate endpoint can push the result back out of the rectangle.
+  const double start_x = line.x0;
+  const double start_y = line.y0;
+  const double delta_x = static_cast<double>(line.x1) - line.x0;
+  const double delta_y = static_cast<double>(line.y1) - line.y0;
+  double t_enter = 0.0;
+  double t_leave = 1.0;
+  // the part of the line with delta * t <= limit
+  const auto clip_border = [&](const double delta, const double limit) {
+    if (0.0 == delta) { return limit >= 0.0; }
+    const double t_border = limit / delta;
+    if (delta < 0.0) {
+      t_enter = std::max(t_enter, t_border);
+    } else {
+      t_leave = std::min(t_leave, t_border);
+    }
+    return t_enter <= t_leave;
+  };
+  if (!clip_border(-delta_x, start_x + 0.5) || !clip_border(delta_x, x_max + 0.5 - start_x) || !clip_border(-delta_y, start_y + 0.5)
+      || !clip_border(delta_y, y_max + 0.5 - start_y)) {
+    return false;
+  }
+
+  // endpoints are rounded to the pixel they fall in and clamped into the image; z is taken where the major axis
+  // reaches that pixel, as Bresenham will step it
+  const bool x_major = std::abs(delta_x) >= std::abs(delta_y);
+  const double delta_z = static_cast<double>(line.z1) - line.z0;
+  const auto endpoint = [&](const double t_param, int &x_coord, int &y_coord, int &z_coord) {
+    x_coord = static_cast<int>(std::clamp(std::round(start_x + (t_param * delta_x)), 0.0, x_max));
+    y_coord = static_cast<int>(std::clamp(std::round(start_y + (t_param * delta_y)), 0.0, y_max));
+    const double major_delta = x_major ? delta_x : delta_y;
+    const double t_pixel = 0.0 == major_delta ? 0.0 : (x_major ? x_coord - start_x : y_coord - start_y) / major_delta;
+    z_coord = static_cast<int>(std::round(line.z0 + (std::clamp(t_pixel, 0.0, 1.0) * delta_z)));
+  };
+  LineSegment clipped {};
+  endpoint(t_enter, clipped.x0, clipped.y0, clipped.z0);
+  endpoint(t_leave, clipped.x1, clipped.y1, clipped.z1);
+  line = clipped;
+  return true;
+}
+
+void draw_line(const int x0, const int y0, const int x1, const int y1, TGAImage &img, const TGAColor &color)
+{
+  const LineSegment line { x0, y0, 0, x1, y1, 0 };
+  draw_lines(img, std::span<const LineSegment>(&line, 1), color);
+}
+
+void draw_lines(TGAImage &img, std::span<const LineSegment> lines, const TGAColor &color)
+{
+  draw_lines_impl<false>(img, nullptr, lines, color, 0);
+}
+
+void draw_lines_depth(TGAImage &img,
+  const TGAImage &zbuffer,
+  std::span<const LineSegment> lines,
+  const TGAColor &color,
+  const int depth_bias)
+{
+  if (zbuffer.width() != img.width() || zbuffer.height() != img.height() || zbuffer.bytes_per_pixel() != TGAImage::GRAYSCALE) {
+    return;
+  }
+  draw_lines_impl<true>(img, &zbuffer, lines, color, depth_bias);
+}
+
+std::vector<std::array<std::uint32_t, 2>> extract_edges(std::span<const OBJFaceElements> faces)
+{
+  // (smaller << 32 | larger) keys sort and deduplicate as plain integers
+  std::vector<std::uint64_t> keys;
+  keys.reserve(faces.size() * 3);
+  for (const auto &face : faces) {
+    for (std::size_t corner = 0; corner < 3; ++corner) {
+      const auto vert_a = static_cast<std::uint32_t>(face.face_vertices.at(corner) - 1);
+      const auto vert_b = static_cast<std::uint32_t>(face.face_vertices.at((corner + 1) % 3) - 1);
+      if (vert_a == vert_b) { continue; }
+      keys.push_back((static_cast<std::uint64_t>(std::min(vert_a, vert_b)) << 32U) | std::max(vert_a, vert_b));
+    }
+  }
+  std::sort(keys.begin(), keys.end());
+  keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+  std::vector<std::array<std::uint32_t, 2>> edges(keys.size());
+  for (std::size_t index = 0; index < keys.size(); ++index) {
+    edges[index] = { static_cast<std::uint32_t>(keys[index] >> 32U), static_cast<std::uint32_t>(keys[index] & UINT32_MAX) };
+  }
+  return edges;
+}
@@ -0,0 +1,80 @@
+#ifndef LINES_HPP
+#define LINES_HPP
+#include "tgaimage.hpp"
+#include "objreader.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Screen space line from (x0, y0) to (x1, y1), both ends included. z uses the z-buffer convention (0..255, larger is
+// closer) and is only read by the depth-tested variants.
+struct LineSegment
+{
+  int x0 = 0;
+  int y0 = 0;
+  int z0 = 0;
+  int x1 = 0;
+  int y1 = 0;
+  int z1 = 0;
+};
+
+// Clips against the pixel rectangle [0, width) x [0, height) in floating point; the new endpoints are rounded and
+// clamped into the image and z is interpolated along with them. Returns false when the line misses every pixel.
+bool clip_line(LineSegment &line, const int width, const int height);
+
+// integer Bresenham, clipped to the image
+void draw_line(const int x0, const int y0, const int x1, const int y1, TGAImage &img, const TGAColor &color);
+
+// Batched variants: clipping and the bytes-per-pixel dispatch happen once per line, pixels are written straight into
+// the image rows.
+void draw_lines(TGAImage &img, std::span<const LineSegment> lines, const TGAColor &color);
+
+// Only pixels where the line is at most depth_bias behind the z-buffer are drawn, so lines can be laid over an already
+// shaded image without z-fighting the surface they lie on. The z-buffer is not written.
+void draw_lines_depth(TGAImage &img,
+  const TGAImage &zbuffer,
+  std::span<const LineSegment> lines,
+  const TGAColor &color,
+  const int depth_bias = 2);
+
+// every edge of the faces exactly once, as zero-based vertex index pairs (smaller index first)
+std::vector<std::array<std::uint32_t, 2>> extract_edges(std::span<const OBJFaceElements> faces);
+
+// Draws edges of screen space vertices (see OBJObject::viewport_transform) with the same truncation as
+// draw_triangles, depth tested against zbuffer when one is given.
+template<typename T>
+void draw_wireframe(TGAImage &img,
+  std::span<const OBJVertex<T>> vertices,
+  std::span<const std::array<std::uint32_t, 2>> edges,
+  const TGAColor &color,
+  const TGAImage *zbuffer = nullptr,
+  const int depth_bias = 2)
+{
+  constexpr std::size_t batch_size = 256;
+  std::array<LineSegment, batch_size> batch {};
+  for (std::size_t first = 0; first < edges.size(); first += batch_size) {
+    const std::size_t count = std::min(batch_size, edges.size() - first);
+    for (std::size_t index = 0; index < count; ++index) {
+      const auto &vert_a = vertices[edges[first + index][0]];
+      const auto &vert_b = vertices[edges[first + index][1]];
+      batch.at(index) = { static_cast<int>(vert_a.get_x()),
+        static_cast<int>(vert_a.get_y()),
+        static_cast<int>(vert_a.get_z()),
+        static_cast<int>(vert_b.get_x()),
+        static_cast<int>(vert_b.get_y()),
+        static_cast<int>(vert_b.get_z()) };
+    }
+    const auto lines = std::span<const LineSegment>(batch).first(count);
+    if (zbuffer != nullptr) {
+      draw_lines_depth(img, *zbuffer, lines, color, depth_bias);
+    } else {
+      draw_lines(img, lines, color);
+    }
+  }
+}
+
+#endif //LINES_HPP
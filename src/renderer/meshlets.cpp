@@ -0,0 +1,380 @@
+#include "meshlets.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <numbers>
+#include <numeric>
+#include <system_error>
+
+namespace {
+
+using Vec3 = std::array<float, 3>;
+
+constexpr std::array<char, 8> cache_magic = { 'B', 'R', 'M', 'L', 'T', 'C', 'H', '\0' };
+constexpr std::uint32_t cache_version = 1;
+constexpr std::uint32_t leaf_meshlets = 4;
+// traversal stack of cull_meshlets: one pending sibling per level plus the two children just pushed
+constexpr std::size_t cull_stack_size = 64;
+
+struct CacheHeader
+{
+  std::array<char, 8> magic = cache_magic;
+  std::uint32_t version = cache_version;
+  std::uint32_t meshlet_count = 0;
+  std::uint64_t face_count = 0;
+  std::uint64_t vertex_count = 0;
+  std::uint64_t source_size = 0;
+  std::int64_t source_mtime = 0;
+  std::uint64_t node_count = 0;
+};
+
+float dot(const Vec3 &lhs, const Vec3 &rhs) { return (lhs[0] * rhs[0]) + (lhs[1] * rhs[1]) + (lhs[2] * rhs[2]); }
+
+Vec3 to_vec(const OBJVertex<float> &vert) { return { vert.get_x(), vert.get_y(), vert.get_z() }; }
+
+Vec3 face_normal(const OBJObject<float> &mesh, const OBJFaceElements &face)
+{
+  const Vec3 vert_a = to_vec(mesh.vertices.at(static_cast<std::size_t>(face.face_vertices.at(0) - 1)));
+  const Vec3 vert_b = to_vec(mesh.vertices.at(static_cast<std::size_t>(face.face_vertices.at(1) - 1)));
+  const Vec3 vert_c = to_vec(mesh.vertices.at(static_cast<std::size_t>(face.face_vertices.at(2) - 1)));
+  const Vec3 edge1 = { vert_b[0] - vert_a[0], vert_b[1] - vert_a[1], vert_b[2] - vert_a[2] };
+  const Vec3 edge2 = { vert_c[0] - vert_a[0], vert_c[1] - vert_a[1], vert_c[2] - vert_a[2] };
+  const Vec3 cross = { (edge1[1] * edge2[2]) - (edge1[2] * edge2[1]),
+    (edge1[2] * edge2[0]) - (edge1[0] * edge2[2]),
+    (edge1[0] * edge2[1]) - (edge1[1] * edge2[0]) };
+  const float length = std::sqrt(dot(cross, cross));
+  if (0.0F == length) { return {}; }
+  return { cross[0] / length, cross[1] / length, cross[2] / length };
+}
+
+// spreads the low 10 bits of value so that two zero bits separate each of them
+std::uint32_t spread_bits(std::uint32_t value)
+{
+  value &= 0x3FFU;
+  value = (value | (value << 16U)) & 0x030000FFU;
+  value = (value | (value << 8U)) & 0x0300F00FU;
+  value = (value | (value << 4U)) & 0x030C30C3U;
+  value = (value | (value << 2U)) & 0x09249249U;
+  return value;
+}
+
+void apply_face_order(OBJObject<float> &mesh, const std::vector<std::uint32_t> &face_order)
+{
+  const auto permute = [&](auto &values) {
+    if (values.empty()) { return; }
+    auto reordered = values;
+    for (std::size_t index = 0; index < face_order.size(); ++index) { reordered[index] = values[face_order[index]]; }
+    values = std::move(reordered);
+  };
+  permute(mesh.faces);
+  permute(mesh.face_texture_indices);
+  permute(mesh.face_normal_indices);
+}
+
+// smallest sphere centred on the box centre that contains both spheres
+MeshletNode merge_bounds(const MeshletNode &lhs, const MeshletNode &rhs)
+{
+  MeshletNode merged {};
+  Vec3 box_min {};
+  Vec3 box_max {};
+  for (std::size_t axis = 0; axis < 3; ++axis) {
+    box_min.at(axis) = std::min(lhs.center.at(axis) - lhs.radius, rhs.center.at(axis) - rhs.radius);
+    box_max.at(axis) = std::max(lhs.center.at(axis) + lhs.radius, rhs.center.at(axis) + rhs.radius);
+    merged.center.at(axis) = 0.5F * (box_min.at(axis) + box_max.at(axis));
+  }
+  for (const auto *child : { &lhs, &rhs }) {
+    const Vec3 offset = { child->center[0] - merged.center[0], child->center[1] - merged.center[1], child->center[2] - merged.center[2] };
+    merged.radius = std::max(merged.radius, std::sqrt(dot(offset, offset)) + child->radius);
+  }
+  return merged;
+}
+
+void build_node(MeshletBVH &bvh, const std::uint32_t node_index, const std::uint32_t first, const std::uint32_t count)
+{
+  if (count <= leaf_meshlets) {
+    MeshletNode leaf {};
+    for (std::uint32_t index = first; index < first + count; ++index) {
+      const auto &meshlet = bvh.meshlets[index];
+      MeshletNode meshlet_bounds {};
+      meshlet_bounds.center = meshlet.center;
+      meshlet_bounds.radius = meshlet.radius;
+      leaf = (index == first) ? meshlet_bounds : merge_bounds(leaf, meshlet_bounds);
+    }
+    leaf.first = first;
+    leaf.count = count;
+    bvh.nodes[node_index] = leaf;
+    return;
+  }
+  // meshlets are in Morton order, so halving the range is a spatial split
+  const std::uint32_t half = count / 2;
+  const auto left = static_cast<std::uint32_t>(bvh.nodes.size());
+  bvh.nodes.resize(bvh.nodes.size() + 2);
+  build_node(bvh, left, first, half);
+  build_node(bvh, left + 1, first + half, count - half);
+  MeshletNode inner = merge_bounds(bvh.nodes[left], bvh.nodes[left + 1]);
+  inner.first = left;
+  inner.count = 0;
+  bvh.nodes[node_index] = inner;
+}
+
+bool sphere_in_box(const ClusterView &view, const Vec3 &center, const float radius)
+{
+  for (std::size_t axis = 0; axis < 3; ++axis) {
+    const float view_coord = dot(view.rotation.at(axis), center);
+    if (view_coord + radius < view.box_min.at(axis) || view_coord - radius > view.box_max.at(axis)) { return false; }
+  }
+  return true;
+}
+
+std::int64_t source_mtime(const std::filesystem::path &mesh_path)
+{
+  std::error_code error {};
+  const auto mtime = std::filesystem::last_write_time(mesh_path, error);
+  return error ? 0 : std::chrono::duration_cast<std::chrono::nanoseconds>(mtime.time_since_epoch()).count();
+}
+
+std::filesystem::path cache_path(const std::filesystem::path &mesh_path)
+{
+  return std::filesystem::path(mesh_path.string() + ".meshlets");
+}
+
+// Everything cull_meshlets and draw_meshlets index with is in range: face_order is a permutation of the mesh's faces,
+// every meshlet covers faces of the mesh, every leaf covers meshlets, and the inner nodes form a tree rooted at node 0
+// (each other node has one parent, at a lower index) that is shallow enough for the traversal stack.
+bool valid_bvh(const MeshletBVH &bvh, const std::size_t face_count)
+{
+  std::vector<bool> seen(face_count, false);
+  for (const std::uint32_t face : bvh.face_order) {
+    if (face >= face_count || seen[face]) { return false; }
+    seen[face] = true;
+  }
+  for (const auto &meshlet : bvh.meshlets) {
+    if (0 == meshlet.face_count || std::size_t { meshlet.first_face } + meshlet.face_count > face_count) { return false; }
+  }
+  if (bvh.nodes.empty()) { return bvh.meshlets.empty(); }
+
+  std::vector<std::uint32_t> parents(bvh.nodes.size(), 0);
+  std::vector<std::size_t> depth(bvh.nodes.size(), 0);
+  for (std::size_t index = 0; index < bvh.nodes.size(); ++index) {
+    const auto &node = bvh.nodes[index];
+    if (0 != index && 1 != parents[index]) { return false; }
+    if (0 != node.count) {
+      if (std::size_t { node.first } + node.count > bvh.meshlets.size()) { return false; }
+      continue;
+    }
+    if (node.first <= index || std::size_t { node.first } + 1 >= bvh.nodes.size() || depth[index] + 3 > cull_stack_size) {
+      return false;
+    }
+    for (const std::size_t child : { std::size_t { node.first }, std::size_t { node.first } + 1 }) {
+      ++parents[child];
+      depth[child] = depth[index] + 1;
+    }
+  }
+  return true;
+}
+
+}// namespace
+
+ClusterView make_turntable_view(const float yaw_deg, const float pitch_deg)
+{
+  const float yaw = yaw_deg * std::numbers::pi_v<float> / 180.0F;
+  const float pitch = pitch_deg * std::numbers::pi_v<float> / 180.0F;
+  const float cos_yaw = std::cos(yaw);
+  const float sin_yaw = std::sin(yaw);
+  const float cos_pitch = std::cos(pitch);
+  const float sin_pitch = std::sin(pitch);
+  ClusterView view {};
+  view.rotation = { { { cos_yaw, 0.0F, sin_yaw },
+    { sin_yaw * sin_pitch, cos_pitch, -cos_yaw * sin_pitch },
+    { -sin_yaw * cos_pitch, sin_pitch, cos_yaw * cos_pitch } } };
+  return view;
+}
+
+MeshletBVH build_meshlets(OBJObject<float> &mesh, const std::size_t max_triangles)
+{
+  MeshletBVH bvh {};
+  if (mesh.faces.empty()) { return bvh; }
+
+  // sort faces along a Morton curve through their centroids
+  Vec3 bounds_min {};
+  Vec3 bounds_max {};
+  bounds_min.fill(std::numeric_limits<float>::max());
+  bounds_max.fill(std::numeric_limits<float>::lowest());
+  for (const auto &vert : mesh.vertices) {
+    for (std::size_t axis = 0; axis < 3; ++axis) {
+      bounds_min.at(axis) = std::min(bounds_min.at(axis), vert.vertex_coords.at(axis));
+      bounds_max.at(axis) = std::max(bounds_max.at(axis), vert.vertex_coords.at(axis));
+    }
+  }
+  constexpr float morton_cells = 1023.0F;
+  std::vector<std::uint32_t> morton_codes(mesh.faces.size());
+  for (std::size_t face_index = 0; face_index < mesh.faces.size(); ++face_index) {
+    std::uint32_t code = 0;
+    for (std::size_t axis = 0; axis < 3; ++axis) {
+      float centroid = 0.0F;
+      for (const int vertex : mesh.faces[face_index].face_vertices) {
+        centroid += mesh.vertices.at(static_cast<std::size_t>(vertex - 1)).vertex_coords.at(axis) / 3.0F;
+      }
+      const float extent = bounds_max.at(axis) - bounds_min.at(axis);
+      const float cell = extent > 0.0F ? (centroid - bounds_min.at(axis)) / extent * morton_cells : 0.0F;
+      code |= spread_bits(static_cast<std::uint32_t>(std::clamp(cell, 0.0F, morton_cells))) << static_cast<std::uint32_t>(axis);
+    }
+    morton_codes[face_index] = code;
+  }
+  bvh.face_order.resize(mesh.faces.size());
+  std::iota(bvh.face_order.begin(), bvh.face_order.end(), 0U);
+  std::stable_sort(bvh.face_order.begin(), bvh.face_order.end(), [&](const std::uint32_t lhs, const std::uint32_t rhs) {
+    return morton_codes[lhs] < morton_codes[rhs];
+  });
+  apply_face_order(mesh, bvh.face_order);
+
+  const std::size_t triangles_per_meshlet = std::max<std::size_t>(max_triangles, 1);
+  for (std::size_t first = 0; first < mesh.faces.size(); first += triangles_per_meshlet) {
+    Meshlet meshlet {};
+    meshlet.first_face = static_cast<std::uint32_t>(first);
+    meshlet.face_count = static_cast<std::uint32_t>(std::min(triangles_per_meshlet, mesh.faces.size() - first));
+    const auto faces = std::span<const OBJFaceElements>(mesh.faces).subspan(meshlet.first_face, meshlet.face_count);
+
+    Vec3 box_min {};
+    Vec3 box_max {};
+    box_min.fill(std::numeric_limits<float>::max());
+    box_max.fill(std::numeric_limits<float>::lowest());
+    Vec3 normal_sum {};
+    for (const auto &face : faces) {
+      for (const int vertex : face.face_vertices) {
+        const auto &coords = mesh.vertices.at(static_cast<std::size_t>(vertex - 1)).vertex_coords;
+        for (std::size_t axis = 0; axis < 3; ++axis) {
+          box_min.at(axis) = std::min(box_min.at(axis), coords.at(axis));
+          box_max.at(axis) = std::max(box_max.at(axis), coords.at(axis));
+        }
+      }
+      const Vec3 normal = face_normal(mesh, face);
+      for (std::size_t axis = 0; axis < 3; ++axis) { normal_sum.at(axis) += normal.at(axis); }
+    }
+    for (std::size_t axis = 0; axis < 3; ++axis) { meshlet.center.at(axis) = 0.5F * (box_min.at(axis) + box_max.at(axis)); }
+    for (const auto &face : faces) {
+      for (const int vertex : face.face_vertices) {
+        const auto &coords = mesh.vertices.at(static_cast<std::size_t>(vertex - 1)).vertex_coords;
+        const Vec3 offset = { coords[0] - meshlet.center[0], coords[1] - meshlet.center[1], coords[2] - meshlet.center[2] };
+        meshlet.radius = std::max(meshlet.radius, std::sqrt(dot(offset, offset)));
+      }
+    }
+
+    // normal cone: the average normal, opened up to the widest face normal
+    const float sum_length = std::sqrt(dot(normal_sum, normal_sum));
+    meshlet.cone_sin = 1.0F;
+    if (sum_length > 0.0F) {
+      meshlet.cone_axis = { normal_sum[0] / sum_length, normal_sum[1] / sum_length, normal_sum[2] / sum_length };
+      float min_cos = 1.0F;
+      for (const auto &face : faces) {
+        const Vec3 normal = face_normal(mesh, face);
+        if (0.0F == dot(normal, normal)) { continue; }
+        min_cos = std::min(min_cos, dot(normal, meshlet.cone_axis));
+      }
+      // a cone wider than a hemisphere always has some front-facing normal
+      if (min_cos > 0.0F) { meshlet.cone_sin = std::sqrt(1.0F - (min_cos * min_cos)); }
+    }
+    bvh.meshlets.push_back(meshlet);
+  }
+
+  // no tree for an empty mesh: a root leaf without meshlets would read as an inner node
+  if (bvh.meshlets.empty()) { return bvh; }
+  bvh.nodes.resize(1);
+  build_node(bvh, 0, 0, static_cast<std::uint32_t>(bvh.meshlets.size()));
+  return bvh;
+}
+
+void cull_meshlets(const MeshletBVH &bvh, const ClusterView &view, std::vector<std::uint32_t> &visible, CullStats &stats)
+{
+  if (bvh.nodes.empty()) { return; }
+  // direction towards the viewer in object space
+  const Vec3 to_viewer = { view.rotation[2][0], view.rotation[2][1], view.rotation[2][2] };
+
+  std::array<std::uint32_t, cull_stack_size> stack {};
+  std::size_t stack_size = 0;
+  stack.at(stack_size++) = 0;
+  while (stack_size > 0) {
+    const auto &node = bvh.nodes[stack.at(--stack_size)];
+    ++stats.nodes_visited;
+    if (!sphere_in_box(view, node.center, node.radius)) { continue; }
+    if (0 == node.count) {
+      stack.at(stack_size++) = node.first + 1;
+      stack.at(stack_size++) = node.first;
+      continue;
+    }
+    for (std::uint32_t index = node.first; index < node.first + node.count; ++index) {
+      const auto &meshlet = bvh.meshlets[index];
+      ++stats.meshlets_tested;
+      if (!sphere_in_box(view, meshlet.center, meshlet.radius)) { continue; }
+      if (view.backface_culling && dot(meshlet.cone_axis, to_viewer) < -meshlet.cone_sin) { continue; }
+      ++stats.meshlets_visible;
+      stats.faces_visible += meshlet.face_count;
+      visible.push_back(index);
+    }
+  }
+}
+
+bool write_meshlet_cache(const std::filesystem::path &mesh_path, const OBJObject<float> &mesh, const MeshletBVH &bvh)
+{
+  std::ofstream out(cache_path(mesh_path), std::ios::binary);
+  if (!out.is_open()) { return false; }
+  CacheHeader header {};
+  header.meshlet_count = static_cast<std::uint32_t>(bvh.meshlets.size());
+  header.face_count = mesh.faces.size();
+  header.vertex_count = mesh.vertices.size();
+  std::error_code error {};
+  header.source_size = std::filesystem::file_size(mesh_path, error);
+  header.source_mtime = source_mtime(mesh_path);
+  header.node_count = bvh.nodes.size();
+  out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  out.write(reinterpret_cast<const char *>(bvh.face_order.data()), static_cast<std::streamsize>(bvh.face_order.size() * sizeof(std::uint32_t)));
+  out.write(reinterpret_cast<const char *>(bvh.meshlets.data()), static_cast<std::streamsize>(bvh.meshlets.size() * sizeof(Meshlet)));
+  out.write(reinterpret_cast<const char *>(bvh.nodes.data()), static_cast<std::streamsize>(bvh.nodes.size() * sizeof(MeshletNode)));
+  return out.good();
+}
+
+bool read_meshlet_cache(const std::filesystem::path &mesh_path, OBJObject<float> &mesh, MeshletBVH &bvh)
+{
+  std::ifstream in(cache_path(mesh_path), std::ios::binary);
+  if (!in.is_open()) { return false; }
+  CacheHeader header {};
+  in.read(reinterpret_cast<char *>(&header), sizeof(header));
+  std::error_code error {};
+  const std::uintmax_t source_size = std::filesystem::file_size(mesh_path, error);
+  if (!in.good() || header.magic != cache_magic || header.version != cache_version || header.face_count != mesh.faces.size()
+      || header.vertex_count != mesh.vertices.size() || header.source_size != source_size
+      || header.source_mtime != source_mtime(mesh_path)) {
+    return false;
+  }
+  // every meshlet holds at least one face and a binary tree over them has fewer than twice as many nodes, so a
+  // corrupt header can't make these allocations larger than the mesh
+  if (header.meshlet_count > header.face_count || header.node_count > 2 * std::uint64_t { header.meshlet_count }) { return false; }
+  MeshletBVH cached {};
+  cached.face_order.resize(header.face_count);
+  cached.meshlets.resize(header.meshlet_count);
+  cached.nodes.resize(header.node_count);
+  in.read(reinterpret_cast<char *>(cached.face_order.data()), static_cast<std::streamsize>(cached.face_order.size() * sizeof(std::uint32_t)));
+  in.read(reinterpret_cast<char *>(cached.meshlets.data()), static_cast<std::streamsize>(cached.meshlets.size() * sizeof(Meshlet)));
+  in.read(reinterpret_cast<char *>(cached.nodes.data()), static_cast<std::streamsize>(cached.nodes.size() * sizeof(MeshletNode)));
+  if (!in.good() || !valid_bvh(cached, mesh.faces.size())) { return false; }
+  apply_face_order(mesh, cached.face_order);
+  bvh = std::move(cached);
+  return true;
+}
+
+MeshletBVH load_or_build_meshlets(const std::filesystem::path &mesh_path, OBJObject<float> &mesh, bool &from_cache)
+{
+  MeshletBVH bvh {};
+  from_cache = read_meshlet_cache(mesh_path, mesh, bvh);
+  if (from_cache) { return bvh; }
+  bvh = build_meshlets(mesh);
+  if (!write_meshlet_cache(mesh_path, mesh, bvh)) { std::cerr << "can't write meshlet cache for " << mesh_path << "\n"; }
+  return bvh;
+}
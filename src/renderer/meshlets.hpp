@@ -0,0 +1,113 @@
+#ifndef MESHLETS_HPP
+#define MESHLETS_HPP
+#include "tgaimage.hpp"
+#include "objreader.hpp"
+#include "rasterizer.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <vector>
+
+// A meshlet is a run of spatially close faces (mesh.faces[first_face, first_face + face_count)) with a bounding
+// sphere for frustum tests and a normal cone for backface tests, both in object space.
+struct Meshlet
+{
+  std::uint32_t first_face = 0;
+  std::uint32_t face_count = 0;
+  std::array<float, 3> center {};
+  float radius = 0.0F;
+  std::array<float, 3> cone_axis {};
+  // sine of the cone half-angle, >= 1 when the cone is too wide to ever be back-facing
+  float cone_sin = 1.0F;
+};
+
+// leaves cover meshlets [first, first + count), inner nodes (count == 0) have children first and first + 1
+struct MeshletNode
+{
+  std::array<float, 3> center {};
+  float radius = 0.0F;
+  std::uint32_t first = 0;
+  std::uint32_t count = 0;
+};
+
+struct MeshletBVH
+{
+  std::vector<Meshlet> meshlets;
+  std::vector<MeshletNode> nodes;
+  // face_order[i] is the index the i-th reordered face had in the file
+  std::vector<std::uint32_t> face_order;
+};
+
+// Orthographic view: object space is rotated, then everything inside box_min..box_max (normalised device
+// coordinates, +z towards the viewer) is visible.
+struct ClusterView
+{
+  std::array<std::array<float, 3>, 3> rotation { { { 1.0F, 0.0F, 0.0F }, { 0.0F, 1.0F, 0.0F }, { 0.0F, 0.0F, 1.0F } } };
+  std::array<float, 3> box_min { -1.0F, -1.0F, -1.0F };
+  std::array<float, 3> box_max { 1.0F, 1.0F, 1.0F };
+  bool backface_culling = true;
+};
+
+struct CullStats
+{
+  std::size_t nodes_visited = 0;
+  std::size_t meshlets_tested = 0;
+  std::size_t meshlets_visible = 0;
+  std::size_t faces_visible = 0;
+};
+
+// yaw about the vertical axis, then pitch, in degrees
+ClusterView make_turntable_view(const float yaw_deg, const float pitch_deg);
+
+// Modifies the mesh: mesh.faces, face_texture_indices and face_normal_indices are permuted in place into meshlet
+// order, so face indices taken before the call (and face_color(index)) no longer refer to the same faces. The
+// returned face_order maps the new positions back to the old ones; vertices are not touched.
+MeshletBVH build_meshlets(OBJObject<float> &mesh, const std::size_t max_triangles = 128);
+
+// The cache lives next to the mesh as <mesh>.meshlets and is rebuilt when the mesh file's size or modification time
+// changes. Reading it applies the cached face order to the mesh, which must be the file as loaded, exactly as
+// build_meshlets would have. A cache whose ranges, face order or tree do not fit the mesh is rejected, leaving the
+// mesh untouched, so it is rebuilt.
+bool write_meshlet_cache(const std::filesystem::path &mesh_path, const OBJObject<float> &mesh, const MeshletBVH &bvh);
+bool read_meshlet_cache(const std::filesystem::path &mesh_path, OBJObject<float> &mesh, MeshletBVH &bvh);
+// reorders the mesh like build_meshlets, from the cache when it is up to date
+MeshletBVH load_or_build_meshlets(const std::filesystem::path &mesh_path, OBJObject<float> &mesh, bool &from_cache);
+
+// appends the indices of all meshlets that survive frustum and backface tests
+void cull_meshlets(const MeshletBVH &bvh, const ClusterView &view, std::vector<std::uint32_t> &visible, CullStats &stats);
+
+template<typename T>
+void draw_meshlets(TGAImage &img,
+  std::span<const OBJVertex<T>> vertices,
+  std::span<const OBJFaceElements> faces,
+  const MeshletBVH &bvh,
+  std::span<const std::uint32_t> visible,
+  TGAImage &zbuffer)
+{
+  for (const std::uint32_t meshlet_index : visible) {
+    const auto &meshlet = bvh.meshlets[meshlet_index];
+    for (std::size_t face_index = meshlet.first_face; face_index < meshlet.first_face + meshlet.face_count; ++face_index) {
+      const auto &face = faces[face_index];
+      const auto &vert_a = face_vertex(vertices, face, 0);
+      const auto &vert_b = face_vertex(vertices, face, 1);
+      const auto &vert_c = face_vertex(vertices, face, 2);
+      fill_triangle_zbuffer(static_cast<int>(vert_a.get_x()),
+        static_cast<int>(vert_a.get_y()),
+        static_cast<int>(vert_a.get_z()),
+        static_cast<int>(vert_b.get_x()),
+        static_cast<int>(vert_b.get_y()),
+        static_cast<int>(vert_b.get_z()),
+        static_cast<int>(vert_c.get_x()),
+        static_cast<int>(vert_c.get_y()),
+        static_cast<int>(vert_c.get_z()),
+        img,
+        zbuffer,
+        face_color(face_index));
+    }
+  }
+}
+
+#endif //MESHLETS_HPP
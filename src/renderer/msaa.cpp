@@ -0,0 +1,170 @@
+#include "msaa.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace {
+// rotated grid patterns in 1/16 pixel units, relative to the pixel centre
+constexpr std::array<std::array<int, 2>, 4> pattern_4x = { { { -2, -6 }, { 6, -2 }, { -6, 2 }, { 2, 6 } } };
+constexpr std::array<std::array<int, 2>, 8> pattern_8x = {
+  { { 1, -3 }, { -1, 3 }, { 5, 1 }, { -3, -5 }, { -5, 5 }, { -7, -1 }, { 3, 7 }, { 7, -7 } }
+};
+constexpr float pattern_scale = 1.0F / 16.0F;
+constexpr std::uint32_t fmask_bits = 4;
+constexpr std::uint32_t fmask_slot = 0xF;
+}// namespace
+
+std::uint32_t pack_color(const TGAColor &color)
+{
+  return static_cast<std::uint32_t>(color[0]) | (static_cast<std::uint32_t>(color[1]) << 8U)
+         | (static_cast<std::uint32_t>(color[2]) << 16U) | (static_cast<std::uint32_t>(color[3]) << 24U);
+}
+
+TGAColor unpack_color(const std::uint32_t packed)
+{
+  return { static_cast<std::uint8_t>(packed & 0xFFU),
+    static_cast<std::uint8_t>((packed >> 8U) & 0xFFU),
+    static_cast<std::uint8_t>((packed >> 16U) & 0xFFU),
+    static_cast<std::uint8_t>((packed >> 24U) & 0xFFU) };
+}
+
+MSAAFramebuffer::MSAAFramebuffer(const int width, const int height, const int samples, const TGAColor clear_color)
+  : w(width), h(height), nsamples(samples > 4 ? 8 : 4), clear_value(pack_color(clear_color))
+{
+  full_coverage = (1U << static_cast<std::uint32_t>(nsamples)) - 1U;
+  for (int sample = 0; sample < nsamples; ++sample) {
+    const auto &offset = (8 == nsamples) ? pattern_8x.at(static_cast<std::size_t>(sample))
+                                         : pattern_4x.at(static_cast<std::size_t>(sample));
+    offsets.at(static_cast<std::size_t>(sample)) = { static_cast<float>(offset[0]) * pattern_scale,
+      static_cast<float>(offset[1]) * pattern_scale };
+  }
+  const auto npixels = static_cast<std::size_t>(w * h);
+  colors.resize(npixels);
+  fmask.resize(npixels);
+  depth.resize(npixels * static_cast<std::size_t>(nsamples));
+  clear();
+}
+
+void MSAAFramebuffer::clear()
+{
+  std::fill(colors.begin(), colors.end(), clear_value);
+  std::fill(fmask.begin(), fmask.end(), 0U);
+  std::fill(depth.begin(), depth.end(), std::uint8_t{ 0 });
+  // keep the pool's capacity so steady-state frames do not reallocate
+  slot_pool.clear();
+  free_block = no_block;
+}
+
+std::uint32_t MSAAFramebuffer::slot_color(const std::size_t pixel, const std::uint32_t slot) const
+{
+  if (0 == fmask[pixel]) { return colors[pixel]; }
+  return slot_pool[colors[pixel] + slot];
+}
+
+void MSAAFramebuffer::store_fragment(const std::size_t pixel, const std::uint32_t coverage, const std::uint32_t color)
+{
+  // fast path: the fragment owns every sample, the pixel collapses back to a single colour
+  if (coverage == full_coverage) {
+    if (0 != fmask[pixel]) {
+      slot_pool[colors[pixel]] = free_block;
+      free_block = colors[pixel];
+    }
+    colors[pixel] = color;
+    fmask[pixel] = 0;
+    return;
+  }
+
+  std::uint32_t mask = fmask[pixel];
+  if (0 == mask) {
+    // first partial fragment: spill the pixel colour into slot 0 of a free or fresh pool block
+    const auto block_size = static_cast<std::size_t>(nsamples);
+    std::uint32_t offset = free_block;
+    if (no_block != offset) {
+      free_block = slot_pool[offset];
+      std::fill_n(slot_pool.begin() + static_cast<std::ptrdiff_t>(offset), block_size, colors[pixel]);
+    } else {
+      offset = static_cast<std::uint32_t>(slot_pool.size());
+      slot_pool.resize(slot_pool.size() + block_size, colors[pixel]);
+      pool_peak = std::max(pool_peak, slot_pool.size());
+    }
+    colors[pixel] = offset;
+  }
+
+  std::uint32_t used_slots = 0;
+  for (std::uint32_t sample = 0; sample < static_cast<std::uint32_t>(nsamples); ++sample) {
+    if (!static_cast<bool>(coverage & (1U << sample))) {
+      used_slots |= 1U << ((mask >> (sample * fmask_bits)) & fmask_slot);
+    }
+  }
+  // the uncovered samples reference at most samples-1 slots, so a free one always exists
+  std::uint32_t slot = 0;
+  while (static_cast<bool>(used_slots & (1U << slot))) { ++slot; }
+  slot_pool[colors[pixel] + slot] = color;
+
+  for (std::uint32_t sample = 0; sample < static_cast<std::uint32_t>(nsamples); ++sample) {
+    if (static_cast<bool>(coverage & (1U << sample))) {
+      mask &= ~(fmask_slot << (sample * fmask_bits));
+      mask |= slot << (sample * fmask_bits);
+    }
+  }
+  fmask[pixel] = mask;
+}
+
+void MSAAFramebuffer::resolve(TGAImage &img) const
+{
+  for (int j = 0; j < h; ++j) {
+    for (int i = 0; i < w; ++i) {
+      const auto pixel = static_cast<std::size_t>(i + (j * w));
+      const std::uint32_t mask = fmask[pixel];
+      if (0 == mask) {
+        img.set(i, j, unpack_color(colors[pixel]));
+        continue;
+      }
+      std::array<std::uint32_t, 4> sum {};
+      for (std::uint32_t sample = 0; sample < static_cast<std::uint32_t>(nsamples); ++sample) {
+        const std::uint32_t packed = slot_color(pixel, (mask >> (sample * fmask_bits)) & fmask_slot);
+        for (std::uint32_t channel = 0; channel < 4; ++channel) {
+          sum.at(channel) += (packed >> (channel * 8U)) & 0xFFU;
+        }
+      }
+      const auto divisor = static_cast<std::uint32_t>(nsamples);
+      const auto average = [&](const std::size_t channel) {
+        return static_cast<std::uint8_t>((sum.at(channel) + (divisor / 2)) / divisor);
+      };
+      img.set(i, j, TGAColor(average(0), average(1), average(2), average(3)));
+    }
+  }
+}
+
+void MSAAFramebuffer::resolve_depth(TGAImage &zbuffer) const
+{
+  const auto n_samples = static_cast<std::size_t>(nsamples);
+  for (int j = 0; j < h; ++j) {
+    for (int i = 0; i < w; ++i) {
+      const auto pixel = static_cast<std::size_t>(i + (j * w));
+      const auto first = depth.begin() + static_cast<std::ptrdiff_t>(pixel * n_samples);
+      const std::uint8_t z_val = *std::max_element(first, first + static_cast<std::ptrdiff_t>(n_samples));
+      zbuffer.set(i, j, TGAColor(z_val, z_val, z_val, UINT8_MAX));
+    }
+  }
+}
+
+std::size_t MSAAFramebuffer::memory_bytes() const
+{
+  return (colors.capacity() * sizeof(std::uint32_t)) + (fmask.capacity() * sizeof(std::uint32_t))
+         + (slot_pool.capacity() * sizeof(std::uint32_t)) + depth.capacity();
+}
+
+std::size_t MSAAFramebuffer::supersampled_bytes() const
+{
+  // RGB colour + 8-bit depth for every sample
+  constexpr std::size_t bytes_per_sample = 3 + 1;
+  return static_cast<std::size_t>(w * h) * static_cast<std::size_t>(nsamples) * bytes_per_sample;
+}
+
+std::size_t MSAAFramebuffer::complex_pixels() const
+{
+  return static_cast<std::size_t>(std::count_if(fmask.begin(), fmask.end(), [](const std::uint32_t mask) { return 0 != mask; }));
+}
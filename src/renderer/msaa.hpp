@@ -0,0 +1,178 @@
+#ifndef MSAA_HPP
+#define MSAA_HPP
+#include "tgaimage.hpp"
+#include "objreader.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct SampleOffset {
+  float x;
+  float y;
+};
+
+// Multi-sample framebuffer: coverage and depth are stored per sample, but colour is stored per fragment.
+// Every pixel has one 32-bit colour word and a 4-bit-per-sample mask (fmask) selecting the colour slot of each sample.
+// Pixels fully covered by a single triangle keep fmask == 0 and the colour word holds their colour; edge pixels move
+// their colours into a pool of `samples` slots and the colour word holds the pool offset instead. When a pixel collapses
+// back to one colour its block goes on a free list in the pool itself, so overdraw at edges reuses blocks instead of
+// growing the pool until clear().
+class MSAAFramebuffer
+{
+public:
+  static constexpr int max_samples = 8;
+
+  // values of samples above 4 select 8 samples, anything else 4
+  MSAAFramebuffer(const int width, const int height, const int samples, const TGAColor clear_color = {});
+
+  void clear();
+
+  // shader(lam1, lam2, lam3) is invoked at most once per covered pixel and must return the fragment colour
+  template<typename Shader>
+  void fill_triangle(const float ax,
+				     const float ay,
+				     const float az,
+				     const float bx,
+				     const float by,
+				     const float bz,
+				     const float cx,
+				     const float cy,
+				     const float cz,
+				     Shader &&shader);
+
+  void resolve(TGAImage &img) const;
+  void resolve_depth(TGAImage &zbuffer) const;
+
+  [[nodiscard]] int width() const { return w; }
+  [[nodiscard]] int height() const { return h; }
+  [[nodiscard]] int samples() const { return nsamples; }
+  [[nodiscard]] const SampleOffset &sample_offset(const int sample) const { return offsets.at(static_cast<std::size_t>(sample)); }
+
+  // bytes held by the sample storage, and the bytes a plain supersampled RGB + depth target would need
+  [[nodiscard]] std::size_t memory_bytes() const;
+  [[nodiscard]] std::size_t supersampled_bytes() const;
+  // pixels whose samples reference more than one colour slot
+  [[nodiscard]] std::size_t complex_pixels() const;
+  // largest size the slot pool has reached since construction, in bytes
+  [[nodiscard]] std::size_t pool_high_water_bytes() const { return pool_peak * sizeof(std::uint32_t); }
+
+private:
+  static constexpr std::uint32_t no_block = UINT32_MAX;
+
+  void store_fragment(const std::size_t pixel, const std::uint32_t coverage, const std::uint32_t color);
+  [[nodiscard]] std::uint32_t slot_color(const std::size_t pixel, const std::uint32_t slot) const;
+
+  int w = 0;
+  int h = 0;
+  int nsamples = 4;
+  std::uint32_t full_coverage = 0;
+  std::uint32_t clear_value = 0;
+  std::array<SampleOffset, max_samples> offsets {};
+  std::vector<std::uint32_t> colors;
+  std::vector<std::uint32_t> fmask;
+  std::vector<std::uint32_t> slot_pool;
+  // first free pool block; slot 0 of a free block holds the offset of the next one
+  std::uint32_t free_block = no_block;
+  std::size_t pool_peak = 0;
+  std::vector<std::uint8_t> depth;
+};
+
+std::uint32_t pack_color(const TGAColor &color);
+TGAColor unpack_color(const std::uint32_t packed);
+
+template<typename Shader>
+void MSAAFramebuffer::fill_triangle(const float ax,
+							  const float ay,
+							  const float az,
+							  const float bx,
+							  const float by,
+							  const float bz,
+							  const float cx,
+							  const float cy,
+							  const float cz,
+							  Shader &&shader)
+{
+  const float sarea_total = ((bx - ax) * (cy - ay)) - ((cx - ax) * (by - ay));
+  if (sarea_total == 0.0F) { return; }
+  const float inv_area = 1.0F / sarea_total;
+
+  const int x_min = std::max(0, static_cast<int>(std::floor(std::min({ ax, bx, cx }))));
+  const int y_min = std::max(0, static_cast<int>(std::floor(std::min({ ay, by, cy }))));
+  const int x_max = std::min(w - 1, static_cast<int>(std::ceil(std::max({ ax, bx, cx }))));
+  const int y_max = std::min(h - 1, static_cast<int>(std::ceil(std::max({ ay, by, cy }))));
+
+  // normalised barycentrics of point (px, py)
+  const auto barycentric = [&](const float px, const float py) {
+    return std::array<float, 3>{ (((bx - px) * (cy - py)) - ((cx - px) * (by - py))) * inv_area,
+      (((cx - px) * (ay - py)) - ((ax - px) * (cy - py))) * inv_area,
+      (((ax - px) * (by - py)) - ((bx - px) * (ay - py))) * inv_area };
+  };
+
+  const auto n_samples = static_cast<std::size_t>(nsamples);
+  std::array<std::uint8_t, max_samples> sample_z {};
+  for (int j = y_min; j <= y_max; ++j) {
+    for (int i = x_min; i <= x_max; ++i) {
+      const auto pixel = static_cast<std::size_t>(i + (j * w));
+      const float centre_x = static_cast<float>(i) + 0.5F;
+      const float centre_y = static_cast<float>(j) + 0.5F;
+      std::uint8_t *pixel_depth = depth.data() + (pixel * n_samples);
+
+      std::uint32_t coverage = 0;
+      int first_covered = -1;
+      for (int sample = 0; sample < nsamples; ++sample) {
+        const auto &offset = offsets.at(static_cast<std::size_t>(sample));
+        const auto lam = barycentric(centre_x + offset.x, centre_y + offset.y);
+        if (lam[0] < 0.0F || lam[1] < 0.0F || lam[2] < 0.0F) { continue; }
+        const auto z_val = static_cast<std::uint8_t>((lam[0] * az) + (lam[1] * bz) + (lam[2] * cz));
+        if (pixel_depth[sample] < z_val) {
+          coverage |= 1U << static_cast<std::uint32_t>(sample);
+          sample_z.at(static_cast<std::size_t>(sample)) = z_val;
+          if (first_covered < 0) { first_covered = sample; }
+        }
+      }
+      if (0 == coverage) { continue; }
+
+      // shade once: at the pixel centre when it is inside, otherwise at the first covered sample
+      auto lam = barycentric(centre_x, centre_y);
+      if ((lam[0] < 0.0F || lam[1] < 0.0F || lam[2] < 0.0F)) {
+        const auto &offset = offsets.at(static_cast<std::size_t>(first_covered));
+        lam = barycentric(centre_x + offset.x, centre_y + offset.y);
+      }
+      const std::uint32_t color = pack_color(shader(lam[0], lam[1], lam[2]));
+
+      for (int sample = 0; sample < nsamples; ++sample) {
+        if (static_cast<bool>(coverage & (1U << static_cast<std::uint32_t>(sample)))) {
+          pixel_depth[sample] = sample_z.at(static_cast<std::size_t>(sample));
+        }
+      }
+      store_fragment(pixel, coverage, color);
+    }
+  }
+}
+
+template<typename T, typename FaceShader>
+void draw_triangles_msaa(MSAAFramebuffer &fb, const OBJObject<T> &obj, FaceShader &&face_shader)
+{
+  for (std::size_t face_index = 0; face_index < obj.faces.size(); ++face_index) {
+    const auto &face = obj.faces[face_index];
+    const auto &vert_a = obj.vertices.at(static_cast<size_t>(face.face_vertices.at(0) - 1));
+    const auto &vert_b = obj.vertices.at(static_cast<size_t>(face.face_vertices.at(1) - 1));
+    const auto &vert_c = obj.vertices.at(static_cast<size_t>(face.face_vertices.at(2) - 1));
+    fb.fill_triangle(static_cast<float>(vert_a.get_x()),
+      static_cast<float>(vert_a.get_y()),
+      static_cast<float>(vert_a.get_z()),
+      static_cast<float>(vert_b.get_x()),
+      static_cast<float>(vert_b.get_y()),
+      static_cast<float>(vert_b.get_z()),
+      static_cast<float>(vert_c.get_x()),
+      static_cast<float>(vert_c.get_y()),
+      static_cast<float>(vert_c.get_z()),
+      [&](const float lam1, const float lam2, const float lam3) { return face_shader(face_index, lam1, lam2, lam3); });
+  }
+}
+
+#endif //MSAA_HPP
@@ -0,0 +1,181 @@
+#ifndef OBJREADER_HPP
+#define OBJREADER_HPP
+#include "tgaimage.hpp"
+
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <print>
+#include <span>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+template <typename T>
+class OBJVertex
+{
+public:
+  std::array<T, 3> vertex_coords;
+  OBJVertex() = default;
+  OBJVertex(const T x_, const T y_, const T z_) : vertex_coords({ x_, y_, z_ }) {};
+
+  [[nodiscard]] T get_x() const { return vertex_coords.at(0); }
+  [[nodiscard]] T get_y() const { return vertex_coords.at(1); }
+  [[nodiscard]] T get_z() const { return vertex_coords.at(2); }
+
+  void print() const {std::print("x = {0}, y = {1}, z = {2}\n", vertex_coords.at(0), vertex_coords.at(1), vertex_coords.at(2));}
+};
+
+class OBJFaceElements
+{
+public:
+  std::array<int,3> face_vertices {};
+  OBJFaceElements() = default;
+  OBJFaceElements(const int tri1, const int tri2, const int tri3)
+  {
+    face_vertices.at(0) = tri1;
+    face_vertices.at(1) = tri2;
+    face_vertices.at(2) = tri3;    
+    }
+  void print() const {std::print("tri1 = {0}, tri2 = {1}, tri3 = {2}\n", face_vertices.at(0), face_vertices.at(1), face_vertices.at(2));}  
+};
+
+template <typename T>
+class OBJObject
+{
+public:
+  std::vector<OBJVertex<T>> vertices;
+  std::vector<OBJFaceElements> faces;
+  // optional attributes, the face index arrays are either empty or parallel to faces (0 = no attribute)
+  std::vector<OBJVertex<T>> texture_coords;
+  std::vector<OBJVertex<T>> normals;
+  std::vector<std::array<int, 3>> face_texture_indices;
+  std::vector<std::array<int, 3>> face_normal_indices;
+
+  OBJObject() = default;
+  
+  void printVertices() const {
+	for (const auto& vertex : vertices){
+	  vertex.print();
+	  }
+  }
+
+  void printFaces() const
+  {
+    for (const auto &face : faces) { face.print(); }
+  }
+
+  void viewport_transform(const TGAImage &img)
+  {
+    const int half_height = img.height() / 2;
+	const int half_width =  img.width()  / 2;
+	const float half_z = static_cast<float>(UINT8_MAX) / 2;
+	for (auto &vert : vertices) {
+	   auto current_x = vert.get_x();
+	   auto current_y = vert.get_y();
+	   auto current_z = static_cast<float>(vert.get_z());
+	   vert.vertex_coords.at(0) = (current_x + static_cast<T>(1)) * half_width;
+	   vert.vertex_coords.at(1) = (current_y + static_cast<T>(1)) * half_height;
+	   vert.vertex_coords.at(2) = std::round((current_z + 1.0F) * half_z);
+	}
+	  
+  }
+
+};
+
+// vertex of a face corner, range checked like vector::at: throws std::out_of_range for an index outside 1..size
+template <typename T>
+const OBJVertex<T> &face_vertex(std::span<const OBJVertex<T>> vertices, const OBJFaceElements &face, const std::size_t corner)
+{
+  const auto index = static_cast<std::size_t>(face.face_vertices.at(corner) - 1);
+  if (index >= vertices.size()) { throw std::out_of_range("face references an undefined vertex"); }
+  return vertices[index];
+}
+
+// false if the file can't be opened or a face references a vertex the file does not define
+template <typename T>
+bool read_obj(const std::filesystem::path &obj_file_path, OBJObject<T>& obj_object)
+{
+  std::ifstream obj_file_stream(obj_file_path);
+  if (!obj_file_stream.is_open()) { return false; }
+  std::string line {};
+  std::string symbol {};  
+  std::stringstream line_stream{};
+  while (std::getline(obj_file_stream, line, '\n')) {
+	line_stream.clear();
+	line_stream.str(line);
+	const size_t symbol_end_index = line.find_first_of(' ');
+	if (!(std::string::npos == symbol_end_index)) {
+	    symbol = line.substr(0, symbol_end_index);
+		line_stream.seekg(static_cast<std::streamoff>(symbol_end_index));
+	} else {
+	  symbol.clear();
+	}
+	if ("v"==symbol) {
+	  T x_coord {};
+	  T y_coord {};
+	  T z_coord {};
+	  line_stream >> x_coord >> y_coord >> z_coord;
+	  obj_object.vertices.emplace_back(x_coord,y_coord,z_coord);
+	}
+	else if ("vt" == symbol) {
+	  T u_coord {};
+	  T v_coord {};
+	  line_stream >> u_coord >> v_coord;
+	  obj_object.texture_coords.emplace_back(u_coord, v_coord, T {});
+	}
+	else if ("vn" == symbol) {
+	  T x_coord {};
+	  T y_coord {};
+	  T z_coord {};
+	  line_stream >> x_coord >> y_coord >> z_coord;
+	  obj_object.normals.emplace_back(x_coord, y_coord, z_coord);
+	}
+	else if("f" == symbol){
+	  // corners are v, v/vt, v//vn or v/vt/vn; only the first three corners are used
+	  std::array<std::array<int, 3>, 3> corners {};
+	  std::string corner_token {};
+	  for (auto &corner : corners) {
+		line_stream >> corner_token;
+		const char *token_end = corner_token.data() + corner_token.size();
+		const char *cursor = corner_token.data();
+		for (auto &index : corner) {
+		  cursor = std::from_chars(cursor, token_end, index).ptr;
+		  if (cursor == token_end || '/' != *cursor) { break; }
+		  ++cursor;
+		}
+	  }
+	  obj_object.faces.emplace_back(corners[0][0], corners[1][0], corners[2][0]);
+	  const auto face_count = obj_object.faces.size();
+	  if (0 != corners[0][1]) {
+		obj_object.face_texture_indices.resize(face_count - 1);
+		obj_object.face_texture_indices.push_back({ corners[0][1], corners[1][1], corners[2][1] });
+	  }
+	  if (0 != corners[0][2]) {
+		obj_object.face_normal_indices.resize(face_count - 1);
+		obj_object.face_normal_indices.push_back({ corners[0][2], corners[1][2], corners[2][2] });
+	  }
+	}
+  }
+  const auto vertex_count = obj_object.vertices.size();
+  for (const auto &face : obj_object.faces) {
+	for (const int index : face.face_vertices) {
+	  if (index < 1 || static_cast<std::size_t>(index) > vertex_count) {
+		std::cerr << "face references an undefined vertex " << index << " in " << obj_file_path << "\n";
+		return false;
+	  }
+	}
+  }
+  if (!obj_object.face_texture_indices.empty()) { obj_object.face_texture_indices.resize(obj_object.faces.size()); }
+  if (!obj_object.face_normal_indices.empty()) { obj_object.face_normal_indices.resize(obj_object.faces.size()); }
+  obj_file_stream.close();
+  return true;
+}
+
+#endif //OBJREADER_HPP
@@ -0,0 +1,150 @@
+#include "rasterizer.hpp"
+#include "lines.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+void draw_triangle(const int ax,
+  const int ay,
+  const int bx,
+  const int by,
+  const int cx,
+  const int cy,
+  TGAImage &img,
+  const TGAColor &clr)
+{
+  draw_line(ax, ay, bx, by, img, clr);
+  draw_line(ax, ay, cx, cy, img, clr);
+  draw_line(cx, cy, bx, by, img, clr);
+}
+
+
+
+TGAColor face_color(const std::size_t face_index)
+{
+  // splitmix-style hash so neighbouring faces get unrelated colours
+  std::uint64_t hash = (face_index + 1) * 0x9E3779B97F4A7C15ULL;
+  hash = (hash ^ (hash >> 30U)) * 0xBF58476D1CE4E5B9ULL;
+  hash = (hash ^ (hash >> 27U)) * 0x94D049BB133111EBULL;
+  hash ^= hash >> 31U;
+  return { static_cast<std::uint8_t>(hash & 0xFFU),
+    static_cast<std::uint8_t>((hash >> 8U) & 0xFFU),
+    static_cast<std::uint8_t>((hash >> 16U) & 0xFFU),
+    UINT8_MAX };
+}
+
+float s_triangle_area(const int ax, const int ay, const int bx, const int by, const int cx, const int cy)
+{
+  // equation for triangle area with vertex coordinates
+  return 0.5F * static_cast<float>(((ax - cx)*(by - ay)) - ((ax - bx)*(cy - ay)));
+}
+
+void fill_triangle_shader(const int ax,
+				   const int ay,
+				   const int az,
+				   const int bx,
+				   const int by,
+				   const int bz,
+				   const int cx,
+				   const int cy,
+				   const int cz,
+				   TGAImage &img)
+{
+  float sarea_total = s_triangle_area(ax, ay, bx, by, cx, cy);
+  Rectangle<int> bounding_box = get_bounding_box<int>(ax, ay, bx, by, cx, cy);
+  for (int i = bounding_box.get_xmin(); i <= bounding_box.get_xmax(); ++i) {
+    for (int j = bounding_box.get_ymin(); j <= bounding_box.get_ymax(); ++j) {
+      // img.set(i,j,clr);
+	  /// TODO: clean dis shi up
+      float sareaPBC = s_triangle_area(i, j, bx, by, cx, cy);
+      float sareaAPC = s_triangle_area(ax, ay, i, j, cx, cy);
+      float sareaABP = s_triangle_area(ax, ay, bx, by, i, j);
+      float lam1 = sareaPBC / sarea_total;
+      float lam2 = sareaAPC / sarea_total;
+      float lam3 = sareaABP / sarea_total;
+	  if(lam1 >= 0.0F && lam2 >= 0.0F && lam3 >= 0.0F) {
+		uint8_t red_value = lam1 * 255;
+		uint8_t blue_value = lam2 * 255;
+		uint8_t green_value = lam3 * 255;
+		TGAColor shade(red_value, blue_value, green_value, 255);
+		img.set(i,j,shade);
+	  }
+	}
+  }
+}
+
+void fill_triangle(const int ax,
+				   const int ay,
+				   const int bx,
+				   const int by,
+				   const int cx,
+				   const int cy,
+				   TGAImage &img,
+				   const TGAColor &clr)
+{
+  float sarea_total = s_triangle_area(ax, ay, bx, by, cx, cy);
+  Rectangle<int> bounding_box = get_bounding_box<int>(ax, ay, bx, by, cx, cy);
+  for (int i = bounding_box.get_xmin(); i <= bounding_box.get_xmax(); ++i) {
+    for (int j = bounding_box.get_ymin(); j <= bounding_box.get_ymax(); ++j) {
+      // img.set(i,j,clr);
+	  /// TODO: clean dis shi up
+	  auto rand_r = static_cast<uint8_t>(std::rand() % UINT8_MAX);
+	  auto rand_g = static_cast<uint8_t>(std::rand() % UINT8_MAX);
+	  auto rand_b = static_cast<uint8_t>(std::rand() % UINT8_MAX);
+    
+	  TGAColor rndColor(rand_r, rand_g, rand_b, 255);
+	  
+      float sareaPBC = s_triangle_area(i, j, bx, by, cx, cy);
+      float sareaAPC = s_triangle_area(ax, ay, i, j, cx, cy);
+      float sareaABP = s_triangle_area(ax, ay, bx, by, i, j);
+      float lam1 = sareaPBC / sarea_total;
+      float lam2 = sareaAPC / sarea_total;
+      float lam3 = sareaABP / sarea_total;
+	  
+	  if(lam1 >= 0.0F && lam2 >= 0.0F && lam3 >= 0.0F) {
+		img.set(i,j,rndColor);
+	  }
+	}
+  }
+}
+
+void fill_triangle_zbuffer(const int ax,
+						   const int ay,
+						   const int az,
+						   const int bx,
+						   const int by,
+						   const int bz,
+						   const int cx,
+						   const int cy,
+						   const int cz,
+						   TGAImage &img,
+						   TGAImage &zbuffer,
+						   const TGAColor &clr)
+{
+  float sarea_total = s_triangle_area(ax, ay, bx, by, cx, cy);
+  
+  Rectangle<int> bounding_box = get_bounding_box<int>(ax, ay, bx, by, cx, cy);
+  for (int i = bounding_box.get_xmin(); i <= bounding_box.get_xmax(); ++i) {
+    for (int j = bounding_box.get_ymin(); j <= bounding_box.get_ymax(); ++j) {
+	  /// TODO: clean dis shi up
+      float sareaPBC = s_triangle_area(i, j, bx, by, cx, cy);
+      float sareaAPC = s_triangle_area(ax, ay, i, j, cx, cy);
+      float sareaABP = s_triangle_area(ax, ay, bx, by, i, j);
+      float lam1 = sareaPBC / sarea_total;
+      float lam2 = sareaAPC / sarea_total;
+      float lam3 = sareaABP / sarea_total;
+	  auto z_val = static_cast<uint8_t>((lam1 * az) + (lam2 * bz) + (lam3 * cz));
+	  //uint8_t z_val = std::round((az + bz + cz) / 3);
+	  TGAColor z_color(z_val, z_val, z_val, UINT8_MAX);      
+	  if(lam1 >= 0.0F && lam2 >= 0.0F && lam3 >= 0.0F) {
+		if(zbuffer.get(i,j)[0] < z_val){
+		  zbuffer.set(i, j, z_color);
+		  img.set(i, j, clr);
+		}
+	  }
+	}
+  }
+}
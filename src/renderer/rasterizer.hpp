@@ -0,0 +1,113 @@
+#ifndef RASTERIZER_HPP
+#define RASTERIZER_HPP
+#include "tgaimage.hpp"
+#include "objreader.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <span>
+
+template<typename T>
+class Rectangle{
+private:
+  std::array<T, 4> vertices;
+public:
+  Rectangle (T x_min, T x_max, T y_min, T y_max) : vertices({x_min, x_max, y_min, y_max}) {}
+  [[nodiscard]] T& get_xmin() {return vertices.at(0);}
+  [[nodiscard]] T& get_xmax() {return vertices.at(1);}
+  [[nodiscard]] T& get_ymin() {return vertices.at(2);}  
+  [[nodiscard]] T& get_ymax() {return vertices.at(3);}
+
+  [[nodiscard]] T& get_xmin() const {return vertices.at(0);}
+  [[nodiscard]] T& get_xmax() const {return vertices.at(1);}
+  [[nodiscard]] T& get_ymin() const {return vertices.at(2);}  
+  [[nodiscard]] T& get_ymax() const {return vertices.at(3);}
+};
+
+// outline only, see lines.hpp for line drawing
+void draw_triangle(const int ax,
+  const int ay,
+  const int bx,
+  const int by,
+  const int cx,
+  const int cy,
+  TGAImage &img,
+  const TGAColor &clr);
+
+// deterministic flat colour for a face, stable across runs and renderers
+TGAColor face_color(const std::size_t face_index);
+
+float s_triangle_area(const int ax, const int ay, const int bx, const int by, const int cx, const int cy);
+
+template<typename T>
+Rectangle<T> get_bounding_box(int ax, int ay, int bx, int by, int cx, int cy){
+  T x_min = std::min({ax, bx, cx});
+  T y_min = std::min({ay, by, cy});
+  T x_max = std::max({ax, bx, cx});
+  T y_max = std::max({ay, by, cy});  
+  return Rectangle(x_min, x_max, y_min, y_max);
+}
+
+void fill_triangle_shader(const int ax,
+				   const int ay,
+				   const int az,
+				   const int bx,
+				   const int by,
+				   const int bz,
+				   const int cx,
+				   const int cy,
+				   const int cz,
+				   TGAImage &img);
+
+void fill_triangle(const int ax,
+				   const int ay,
+				   const int bx,
+				   const int by,
+				   const int cx,
+				   const int cy,
+				   TGAImage &img,
+				   const TGAColor &clr);
+
+void fill_triangle_zbuffer(const int ax,
+						   const int ay,
+						   const int az,
+						   const int bx,
+						   const int by,
+						   const int bz,
+						   const int cx,
+						   const int cy,
+						   const int cz,
+						   TGAImage &img,
+						   TGAImage &zbuffer,
+						   const TGAColor &clr);
+
+// flat shaded with face_color(face index), so the image is the same on every run
+template<typename T> void draw_triangles(TGAImage &img, std::span<const OBJVertex<T>> vertices, std::span<const OBJFaceElements> faces, TGAImage& zbuffer)
+{
+  for (std::size_t face_index = 0; face_index < faces.size(); ++face_index) {
+    const auto &face = faces[face_index];
+    const auto &vert_a = face_vertex(vertices, face, 0);
+    const auto &vert_b = face_vertex(vertices, face, 1);
+    const auto &vert_c = face_vertex(vertices, face, 2);
+    fill_triangle_zbuffer(static_cast<int>(vert_a.get_x()),
+      static_cast<int>(vert_a.get_y()),
+      static_cast<int>(vert_a.get_z()),
+      static_cast<int>(vert_b.get_x()),
+      static_cast<int>(vert_b.get_y()),
+      static_cast<int>(vert_b.get_z()),
+      static_cast<int>(vert_c.get_x()),
+      static_cast<int>(vert_c.get_y()),
+      static_cast<int>(vert_c.get_z()),
+      img,
+      zbuffer,
+      face_color(face_index));
+  }
+}
+
+template<typename T> void draw_triangles(TGAImage &img, const OBJObject<T> &obj, [[maybe_unused]] const TGAColor &color, TGAImage& zbuffer)
+{
+  draw_triangles<T>(img, obj.vertices, obj.faces, zbuffer);
+}
+
+#endif //RASTERIZER_HPP
@@ -0,0 +1,223 @@
+#include "shadow.hpp"
+#include "rasterizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+using Vec3 = std::array<float, 3>;
+
+Vec3 cross(const Vec3 &lhs, const Vec3 &rhs)
+{
+  return { (lhs[1] * rhs[2]) - (lhs[2] * rhs[1]), (lhs[2] * rhs[0]) - (lhs[0] * rhs[2]), (lhs[0] * rhs[1]) - (lhs[1] * rhs[0]) };
+}
+
+float dot(const Vec3 &lhs, const Vec3 &rhs) { return (lhs[0] * rhs[0]) + (lhs[1] * rhs[1]) + (lhs[2] * rhs[2]); }
+
+bool normalize(Vec3 &vec)
+{
+  const float length = std::sqrt(dot(vec, vec));
+  if (length < std::numeric_limits<float>::epsilon()) { return false; }
+  for (float &component : vec) { component /= length; }
+  return true;
+}
+
+// lookups per lookup_pcf call from shade_shadowed; the batch arrays stay in L1
+constexpr std::size_t shade_batch = 64;
+
+}// namespace
+
+ShadowMap::ShadowMap(const int resolution) : depth_map(resolution, resolution, TGAImage::GRAYSCALE) {}
+
+void ShadowMap::set_light(const std::array<float, 3> &towards_light)
+{
+  Vec3 axis_z = towards_light;
+  if (!normalize(axis_z)) { return; }
+  // any right-handed basis around the light direction will do; world up is used unless the light is overhead
+  Vec3 axis_x = cross({ 0.0F, 1.0F, 0.0F }, axis_z);
+  if (!normalize(axis_x)) {
+    axis_x = cross({ 0.0F, 0.0F, 1.0F }, axis_z);
+    normalize(axis_x);
+  }
+  light_dir = axis_z;
+  rotation = { axis_x, cross(axis_z, axis_x), axis_z };
+}
+
+void ShadowMap::render(const OBJObject<float> &mesh, const bool early_out)
+{
+  depth_map.clear();
+  if (mesh.vertices.empty()) { return; }
+
+  Vec3 low { std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
+  Vec3 high { std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest() };
+  for (const auto &vert : mesh.vertices) {
+    const Vec3 position { vert.get_x(), vert.get_y(), vert.get_z() };
+    for (std::size_t axis = 0; axis < 3; ++axis) {
+      const float value = dot(rotation.at(axis), position);
+      low.at(axis) = std::min(low.at(axis), value);
+      high.at(axis) = std::max(high.at(axis), value);
+    }
+  }
+  // texels 0..resolution - 1 and depths 1..255, so 0 still means empty
+  const auto texels = static_cast<float>(resolution() - 1);
+  const auto depths = static_cast<float>(UINT8_MAX - 1);
+  for (std::size_t axis = 0; axis < 3; ++axis) {
+    const float extent = std::max(high.at(axis) - low.at(axis), std::numeric_limits<float>::epsilon());
+    fit_scale.at(axis) = (axis < 2 ? texels : depths) / extent;
+  }
+  fit_min = low;
+
+  corners.resize(mesh.vertices.size());
+  for (std::size_t index = 0; index < mesh.vertices.size(); ++index) {
+    const auto &vert = mesh.vertices[index];
+    const Vec3 texel = to_light({ vert.get_x(), vert.get_y(), vert.get_z() });
+    corners[index] = { static_cast<int>(texel[0]), static_cast<int>(texel[1]), static_cast<int>(std::round(texel[2])) };
+  }
+  std::uint8_t *depth = depth_map.row(0);
+  const int size = resolution();
+  for (const auto &face : mesh.faces) {
+    const auto &vert_a = corners.at(static_cast<std::size_t>(face.face_vertices.at(0) - 1));
+    const auto &vert_b = corners.at(static_cast<std::size_t>(face.face_vertices.at(1) - 1));
+    const auto &vert_c = corners.at(static_cast<std::size_t>(face.face_vertices.at(2) - 1));
+    if (early_out) {
+      fill_depth_only<true>(depth, size, size, vert_a, vert_b, vert_c);
+    } else {
+      fill_depth_only<false>(depth, size, size, vert_a, vert_b, vert_c);
+    }
+  }
+}
+
+std::array<float, 3> ShadowMap::to_light(const std::array<float, 3> &position) const
+{
+  return { (dot(rotation[0], position) - fit_min[0]) * fit_scale[0],
+    (dot(rotation[1], position) - fit_min[1]) * fit_scale[1],
+    ((dot(rotation[2], position) - fit_min[2]) * fit_scale[2]) + 1.0F };
+}
+
+void ShadowMap::lookup_pcf(std::span<const std::array<float, 3>> lookups, const int radius, const float bias, std::span<float> lit) const
+{
+  const std::uint8_t *depth = depth_map.row(0);
+  const int size = resolution();
+  const int taps = ((2 * radius) + 1) * ((2 * radius) + 1);
+  std::array<int, shade_batch> texel_x {};
+  std::array<int, shade_batch> texel_y {};
+  std::array<float, shade_batch> threshold {};
+  std::array<int, shade_batch> unoccluded {};
+  for (std::size_t begin = 0; begin < lookups.size(); begin += shade_batch) {
+    const std::size_t count = std::min(shade_batch, lookups.size() - begin);
+    for (std::size_t index = 0; index < count; ++index) {
+      const auto &lookup = lookups[begin + index];
+      texel_x[index] = static_cast<int>(std::clamp(lookup[0], 0.0F, static_cast<float>(size - 1)));
+      texel_y[index] = static_cast<int>(std::clamp(lookup[1], 0.0F, static_cast<float>(size - 1)));
+      threshold[index] = lookup[2] + bias;
+      unoccluded[index] = 0;
+    }
+    // one tap offset for the whole batch at a time: the inner loop is a gather and compare over independent lookups
+    for (int offset_y = -radius; offset_y <= radius; ++offset_y) {
+      for (int offset_x = -radius; offset_x <= radius; ++offset_x) {
+        for (std::size_t index = 0; index < count; ++index) {
+          const int tap_x = std::clamp(texel_x[index] + offset_x, 0, size - 1);
+          const int tap_y = std::clamp(texel_y[index] + offset_y, 0, size - 1);
+          const std::uint8_t occluder = depth[(static_cast<std::size_t>(tap_y) * static_cast<std::size_t>(size)) + static_cast<std::size_t>(tap_x)];
+          unoccluded[index] += static_cast<float>(occluder) <= threshold[index] ? 1 : 0;
+        }
+      }
+    }
+    for (std::size_t index = 0; index < count; ++index) {
+      lit[begin + index] = static_cast<float>(unoccluded[index]) / static_cast<float>(taps);
+    }
+  }
+}
+
+std::size_t ShadowMap::memory_bytes() const
+{
+  return (static_cast<std::size_t>(resolution()) * static_cast<std::size_t>(resolution())) + (corners.capacity() * sizeof(corners[0]));
+}
+
+std::size_t shade_shadowed(TGAImage &img,
+  const VisibilityBuffer &visibility,
+  std::span<const OBJVertex<float>> vertices,
+  std::span<const OBJFaceElements> faces,
+  const ShadowMap &shadow_map,
+  const ShadowShading &shading)
+{
+  if (img.width() != visibility.width() || img.height() != visibility.height()) { return 0; }
+
+  // n.l and slope bias per face and shadow map coordinates per vertex, so a pixel only interpolates
+  constexpr float max_slope = 10.0F;
+  std::vector<float> diffuse(faces.size());
+  std::vector<float> slope_bias(faces.size());
+  for (std::size_t face_index = 0; face_index < faces.size(); ++face_index) {
+    const auto &face = faces[face_index];
+    std::array<Vec3, 3> corners {};
+    for (std::size_t corner = 0; corner < 3; ++corner) {
+      const auto &vert = face_vertex(vertices, face, corner);
+      corners.at(corner) = { vert.get_x(), vert.get_y(), vert.get_z() };
+    }
+    Vec3 normal = cross({ corners[1][0] - corners[0][0], corners[1][1] - corners[0][1], corners[1][2] - corners[0][2] },
+      { corners[2][0] - corners[0][0], corners[2][1] - corners[0][1], corners[2][2] - corners[0][2] });
+    diffuse[face_index] = normalize(normal) ? std::max(0.0F, dot(normal, shadow_map.light())) : 0.0F;
+    const float slope = diffuse[face_index] > 0.0F
+                          ? std::min(max_slope, std::sqrt(1.0F - (diffuse[face_index] * diffuse[face_index])) / diffuse[face_index])
+                          : max_slope;
+    slope_bias[face_index] = shading.slope_bias * slope * shadow_map.depth_per_texel();
+  }
+  std::vector<Vec3> light_vertices(vertices.size());
+  for (std::size_t index = 0; index < vertices.size(); ++index) {
+    const auto &vert = vertices[index];
+    light_vertices[index] = shadow_map.to_light({ vert.get_x(), vert.get_y(), vert.get_z() });
+  }
+
+  std::uint8_t *pixels = img.row(0);
+  const auto bpp = static_cast<std::size_t>(img.bytes_per_pixel());
+  constexpr float unorm_scale = 1.0F / static_cast<float>(std::numeric_limits<std::uint16_t>::max());
+  std::array<std::size_t, shade_batch> batch_pixels {};
+  std::array<std::uint32_t, shade_batch> batch_faces {};
+  std::array<Vec3, shade_batch> lookups {};
+  std::array<float, shade_batch> lit {};
+  std::size_t batch_size = 0;
+  std::size_t shaded = 0;
+  const auto shade = [&](const std::size_t pixel, const std::size_t face_index, const float lit_fraction) {
+    const float intensity = shading.ambient + ((1.0F - shading.ambient) * diffuse[face_index] * lit_fraction);
+    TGAColor color = face_color(face_index);
+    for (std::size_t channel = 0; channel < 3; ++channel) {
+      color.bgra[channel] = static_cast<std::uint8_t>(static_cast<float>(color.bgra[channel]) * intensity);
+    }
+    std::memcpy(pixels + (pixel * bpp), color.bgra, bpp);
+    ++shaded;
+  };
+  const auto flush = [&] {
+    shadow_map.lookup_pcf(std::span(lookups).first(batch_size), shading.pcf_radius, shading.depth_bias, lit);
+    for (std::size_t index = 0; index < batch_size; ++index) { shade(batch_pixels[index], batch_faces[index], lit[index]); }
+    batch_size = 0;
+  };
+
+  for (std::size_t pixel = 0; pixel < visibility.face_ids.size(); ++pixel) {
+    const std::uint32_t face_index = visibility.face_ids[pixel];
+    if (VisibilityBuffer::no_face == face_index) { continue; }
+    // n.l <= 0 is ambient anyway, no lookup needed
+    if (diffuse[face_index] <= 0.0F) {
+      shade(pixel, face_index, 0.0F);
+      continue;
+    }
+    const auto &face = faces[face_index];
+    const float lam2 = static_cast<float>(visibility.barycentrics[pixel][0]) * unorm_scale;
+    const float lam3 = static_cast<float>(visibility.barycentrics[pixel][1]) * unorm_scale;
+    const float lam1 = 1.0F - lam2 - lam3;
+    const auto &vert_a = light_vertices.at(static_cast<std::size_t>(face.face_vertices.at(0) - 1));
+    const auto &vert_b = light_vertices.at(static_cast<std::size_t>(face.face_vertices.at(1) - 1));
+    const auto &vert_c = light_vertices.at(static_cast<std::size_t>(face.face_vertices.at(2) - 1));
+    for (std::size_t axis = 0; axis < 3; ++axis) {
+      lookups[batch_size][axis] = (lam1 * vert_a[axis]) + (lam2 * vert_b[axis]) + (lam3 * vert_c[axis]);
+    }
+    lookups[batch_size][2] += slope_bias[face_index];
+    batch_pixels[batch_size] = pixel;
+    batch_faces[batch_size] = face_index;
+    if (++batch_size == shade_batch) { flush(); }
+  }
+  if (batch_size > 0) { flush(); }
+  return shaded;
+}
@@ -0,0 +1,133 @@
+#ifndef SHADOW_HPP
+#define SHADOW_HPP
+#include "tgaimage.hpp"
+#include "objreader.hpp"
+#include "deferred.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Shadow mapping for a directional light. Every frame the mesh is rendered once more from the light into a square
+// 8 bit depth map (larger is closer to the light, 0 is empty, like the z-buffer), fitted to the mesh's extent in light
+// space. The main pass resolves visibility as usual and each visible pixel then looks up how much of its
+// neighbourhood in the shadow map is closer to the light (percentage-closer filtering).
+
+// Depth-only fill with the coverage rule of rasterize_triangle: no colour, no barycentrics, only the depth plane is
+// stepped, in exact integers. With SpanEarlyOut a row is left as soon as it has left the triangle, which skips the
+// empty part of the bounding box on the far side.
+template<bool SpanEarlyOut>
+void fill_depth_only(std::uint8_t *depth,
+  const int width,
+  const int height,
+  const std::array<int, 3> &vert_a,
+  const std::array<int, 3> &vert_b,
+  const std::array<int, 3> &vert_c)
+{
+  const auto [ax, ay, az] = vert_a;
+  const auto [bx, by, bz] = vert_b;
+  const auto [cx, cy, cz] = vert_c;
+  const auto edge = [](const int px, const int py, const int qx, const int qy, const int rx, const int ry) {
+    return ((px - rx) * (qy - py)) - ((px - qx) * (ry - py));
+  };
+  const int total = edge(ax, ay, bx, by, cx, cy);
+  if (0 == total) { return; }
+
+  const int x_min = std::max(0, std::min({ ax, bx, cx }));
+  const int y_min = std::max(0, std::min({ ay, by, cy }));
+  const int x_max = std::min(width - 1, std::max({ ax, bx, cx }));
+  const int y_max = std::min(height - 1, std::max({ ay, by, cy }));
+  if (x_min > x_max || y_min > y_max) { return; }
+
+  // depth * total is linear in x as well; 64 bits since edge values times depths overflow 32 bits for large maps
+  const int step1 = by - cy;
+  const int step2 = cy - ay;
+  const int step3 = ay - by;
+  const std::int64_t depth_step = (std::int64_t { step1 } * az) + (std::int64_t { step2 } * bz) + (std::int64_t { step3 } * cz);
+  for (int j = y_min; j <= y_max; ++j) {
+    int edge1 = edge(x_min, j, bx, by, cx, cy);
+    int edge2 = edge(ax, ay, x_min, j, cx, cy);
+    int edge3 = edge(ax, ay, bx, by, x_min, j);
+    std::int64_t depth_total = (std::int64_t { edge1 } * az) + (std::int64_t { edge2 } * bz) + (std::int64_t { edge3 } * cz);
+    std::uint8_t *row = depth + (static_cast<std::size_t>(j) * static_cast<std::size_t>(width));
+    [[maybe_unused]] bool entered = false;
+    for (int i = x_min; i <= x_max; ++i, edge1 += step1, edge2 += step2, edge3 += step3, depth_total += depth_step) {
+      const bool inside = total > 0 ? (edge1 >= 0 && edge2 >= 0 && edge3 >= 0) : (edge1 <= 0 && edge2 <= 0 && edge3 <= 0);
+      if constexpr (SpanEarlyOut) {
+        if (!inside) {
+          if (entered) { break; }
+          continue;
+        }
+        entered = true;
+      } else {
+        if (!inside) { continue; }
+      }
+      const auto z_val = static_cast<std::uint8_t>(depth_total / total);
+      row[i] = std::max(row[i], z_val);
+    }
+  }
+}
+
+struct ShadowShading
+{
+  // PCF kernel of (2 * pcf_radius + 1)^2 texels
+  int pcf_radius = 1;
+  // in 8 bit depth steps, against self-shadowing from depth quantization
+  float depth_bias = 2.0F;
+  // in shadow map texels along the surface slope, against self-shadowing of surfaces at grazing angles to the light
+  float slope_bias = 2.0F;
+  // light that reaches shadowed and back-facing surfaces
+  float ambient = 0.25F;
+};
+
+class ShadowMap
+{
+public:
+  explicit ShadowMap(const int resolution = 1024);
+
+  // direction from the scene towards the light, in the mesh's normalized device coordinates (+z towards the viewer)
+  void set_light(const std::array<float, 3> &towards_light);
+  [[nodiscard]] const std::array<float, 3> &light() const { return light_dir; }
+
+  // depth-only render of the mesh (normalized device coordinates) from the light
+  void render(const OBJObject<float> &mesh, const bool early_out = true);
+
+  // shadow map texel coordinates and unquantized depth of a position, as fitted by the last render
+  [[nodiscard]] std::array<float, 3> to_light(const std::array<float, 3> &position) const;
+
+  // For each lookup (texel x, texel y, depth) the fraction of PCF taps that are not closer to the light than
+  // depth + bias. The taps are applied to the whole batch one after the other.
+  void lookup_pcf(std::span<const std::array<float, 3>> lookups, const int radius, const float bias, std::span<float> lit) const;
+
+  // depth steps per texel along a surface at 45 degrees to the light
+  [[nodiscard]] float depth_per_texel() const { return fit_scale[2] / std::min(fit_scale[0], fit_scale[1]); }
+  [[nodiscard]] int resolution() const { return depth_map.width(); }
+  [[nodiscard]] const TGAImage &depth() const { return depth_map; }
+  [[nodiscard]] std::size_t memory_bytes() const;
+
+private:
+  TGAImage depth_map;
+  std::array<float, 3> light_dir { 0.0F, 0.0F, 1.0F };
+  // rows are the light space x, y and z axes
+  std::array<std::array<float, 3>, 3> rotation { { { 1.0F, 0.0F, 0.0F }, { 0.0F, 1.0F, 0.0F }, { 0.0F, 0.0F, 1.0F } } };
+  // light space to texels and depth: (rotation * p - fit_min) * fit_scale, plus 1 for depth
+  std::array<float, 3> fit_min {};
+  std::array<float, 3> fit_scale { 1.0F, 1.0F, 1.0F };
+  std::vector<std::array<int, 3>> corners;
+};
+
+// Deterministic lighting of a resolved visibility buffer: face_color(face) * (ambient + (1 - ambient) * n.l * lit),
+// with lit from lookup_pcf, in batches of pixels. vertices are the normalized device coordinates the visibility buffer
+// was rasterized from after viewport_transform; faces are the faces it was rasterized with. Returns the number of
+// shaded pixels.
+std::size_t shade_shadowed(TGAImage &img,
+  const VisibilityBuffer &visibility,
+  std::span<const OBJVertex<float>> vertices,
+  std::span<const OBJFaceElements> faces,
+  const ShadowMap &shadow_map,
+  const ShadowShading &shading);
+
+#endif //SHADOW_HPP
@@ -0,0 +1,264 @@
+#include "sort_last.hpp"
+#include "deferred.hpp"
+#include "rasterizer.hpp"
+
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <span>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+
+struct WorkerTiming
+{
+  double render_seconds = 0.0;
+  // at the barrier after rendering, waiting for slower workers
+  double wait_seconds = 0.0;
+  double composite_seconds = 0.0;
+};
+
+// [barrier][timing per worker][colour + depth per worker], mapped shared before forking
+class SharedFrame
+{
+public:
+  SharedFrame(const int workers, const std::size_t pixels, const std::size_t bytes_per_pixel)
+    : nworkers(static_cast<std::size_t>(workers)), npixels(pixels), bpp(bytes_per_pixel)
+  {
+    constexpr std::size_t cache_line = 64;
+    const std::size_t header_bytes = sizeof(pthread_barrier_t) + (nworkers * sizeof(WorkerTiming));
+    buffers_offset = (header_bytes + cache_line - 1) / cache_line * cache_line;
+    slot_bytes = (npixels * (bpp + 1) + cache_line - 1) / cache_line * cache_line;
+    bytes = buffers_offset + (nworkers * slot_bytes);
+    void *mapping = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (MAP_FAILED == mapping) { return; }
+    base = static_cast<std::uint8_t *>(mapping);
+
+    pthread_barrierattr_t attributes {};
+    pthread_barrierattr_init(&attributes);
+    pthread_barrierattr_setpshared(&attributes, PTHREAD_PROCESS_SHARED);
+    barrier_ready = 0 == pthread_barrier_init(barrier(), &attributes, static_cast<unsigned>(nworkers));
+    pthread_barrierattr_destroy(&attributes);
+  }
+  SharedFrame(const SharedFrame &) = delete;
+  SharedFrame &operator=(const SharedFrame &) = delete;
+  ~SharedFrame()
+  {
+    if (barrier_ready) { pthread_barrier_destroy(barrier()); }
+    if (nullptr != base) { munmap(base, bytes); }
+  }
+
+  [[nodiscard]] bool valid() const { return nullptr != base && barrier_ready; }
+  [[nodiscard]] std::size_t size() const { return bytes; }
+  [[nodiscard]] pthread_barrier_t *barrier() const { return reinterpret_cast<pthread_barrier_t *>(base); }
+  [[nodiscard]] WorkerTiming &timing(const int rank) const
+  {
+    return reinterpret_cast<WorkerTiming *>(base + sizeof(pthread_barrier_t))[rank];
+  }
+  [[nodiscard]] std::uint8_t *color(const int rank) const { return base + buffers_offset + (static_cast<std::size_t>(rank) * slot_bytes); }
+  [[nodiscard]] std::uint8_t *depth(const int rank) const { return color(rank) + (npixels * bpp); }
+
+  void composite(const int dst, const int src, const std::size_t begin, const std::size_t end, const bool prefer_src) const
+  {
+    std::uint8_t *dst_color = color(dst);
+    std::uint8_t *dst_depth = depth(dst);
+    const std::uint8_t *src_color = color(src);
+    const std::uint8_t *src_depth = depth(src);
+    for (std::size_t pixel = begin; pixel < end; ++pixel) {
+      // ties go to the lower face range, as in a single in-order pass
+      if (src_depth[pixel] > dst_depth[pixel] || (prefer_src && src_depth[pixel] == dst_depth[pixel])) {
+        dst_depth[pixel] = src_depth[pixel];
+        std::memcpy(dst_color + (pixel * bpp), src_color + (pixel * bpp), bpp);
+      }
+    }
+  }
+
+private:
+  std::size_t nworkers = 0;
+  std::size_t npixels = 0;
+  std::size_t bpp = 0;
+  std::size_t buffers_offset = 0;
+  std::size_t slot_bytes = 0;
+  std::size_t bytes = 0;
+  std::uint8_t *base = nullptr;
+  bool barrier_ready = false;
+};
+
+// pixel range a worker owns after all binary swap rounds
+std::pair<std::size_t, std::size_t> binary_swap_region(const int rank, const int workers, const std::size_t pixels)
+{
+  std::size_t begin = 0;
+  std::size_t end = pixels;
+  for (int bit = 1; bit < workers; bit <<= 1) {
+    const std::size_t mid = begin + ((end - begin) / 2);
+    if (0 != (rank & bit)) {
+      begin = mid;
+    } else {
+      end = mid;
+    }
+  }
+  return { begin, end };
+}
+
+void run_worker(const OBJObject<float> &screen_mesh,
+  const int rank,
+  const int workers,
+  const CompositeMethod method,
+  const int width,
+  const int height,
+  const int bytes_per_pixel,
+  const SharedFrame &frame)
+{
+  const auto render_start = std::chrono::steady_clock::now();
+  const std::size_t face_count = screen_mesh.faces.size();
+  const std::size_t first_face = face_count * static_cast<std::size_t>(rank) / static_cast<std::size_t>(workers);
+  const std::size_t last_face = face_count * static_cast<std::size_t>(rank + 1) / static_cast<std::size_t>(workers);
+  // the slot is still zero from the anonymous mapping, i.e. cleared colour and empty depth
+  shade_forward(frame.color(rank),
+    frame.depth(rank),
+    width,
+    height,
+    static_cast<std::size_t>(bytes_per_pixel),
+    screen_mesh.vertices,
+    std::span<const OBJFaceElements>(screen_mesh.faces).subspan(first_face, last_face - first_face),
+    [first_face](const std::size_t face, float, float, float) { return face_color(first_face + face); });
+  const std::size_t pixels = static_cast<std::size_t>(width) * static_cast<std::size_t>(height);
+  const auto wait_start = std::chrono::steady_clock::now();
+  pthread_barrier_wait(frame.barrier());
+  const auto composite_start = std::chrono::steady_clock::now();
+
+  if (CompositeMethod::binary_swap == method) {
+    std::size_t begin = 0;
+    std::size_t end = pixels;
+    for (int bit = 1; bit < workers; bit <<= 1) {
+      const int partner = rank ^ bit;
+      const std::size_t mid = begin + ((end - begin) / 2);
+      const bool upper = 0 != (rank & bit);
+      if (upper) {
+        begin = mid;
+      } else {
+        end = mid;
+      }
+      frame.composite(rank, partner, begin, end, upper);
+      pthread_barrier_wait(frame.barrier());
+    }
+  } else {
+    for (int stride = 1; stride < workers; stride <<= 1) {
+      if (0 == rank % (2 * stride) && rank + stride < workers) { frame.composite(rank, rank + stride, 0, pixels, false); }
+      pthread_barrier_wait(frame.barrier());
+    }
+  }
+
+  const auto composite_stop = std::chrono::steady_clock::now();
+  frame.timing(rank) = { std::chrono::duration<double>(wait_start - render_start).count(),
+    std::chrono::duration<double>(composite_start - wait_start).count(),
+    std::chrono::duration<double>(composite_stop - composite_start).count() };
+}
+
+}// namespace
+
+bool render_sort_last(const OBJObject<float> &screen_mesh,
+  const int workers,
+  CompositeMethod method,
+  TGAImage &img,
+  TGAImage &zbuffer,
+  SortLastStats &stats)
+{
+  if (workers < 1 || img.width() != zbuffer.width() || img.height() != zbuffer.height()
+      || zbuffer.bytes_per_pixel() != TGAImage::GRAYSCALE) {
+    return false;
+  }
+  if (CompositeMethod::binary_swap == method && !std::has_single_bit(static_cast<unsigned>(workers))) {
+    method = CompositeMethod::tree;
+  }
+  const std::size_t pixels = static_cast<std::size_t>(img.width()) * static_cast<std::size_t>(img.height());
+  const auto bpp = static_cast<std::size_t>(img.bytes_per_pixel());
+  const SharedFrame frame(workers, pixels, bpp);
+  if (!frame.valid()) {
+    std::cerr << "can't map " << frame.size() << " bytes of shared memory for sort-last rendering\n";
+    return false;
+  }
+
+  const auto wall_start = std::chrono::steady_clock::now();
+  std::vector<pid_t> children;
+  for (int rank = 0; rank < workers; ++rank) {
+    const pid_t pid = fork();
+    if (0 == pid) {
+      // a forked child never returns into the caller's stack or runs its atexit handlers; the parent sees the
+      // non-zero status and kills the others
+      try {
+        run_worker(screen_mesh, rank, workers, method, img.width(), img.height(), img.bytes_per_pixel(), frame);
+      } catch (...) {
+        _exit(1);
+      }
+      _exit(0);
+    }
+    if (pid < 0) {
+      std::cerr << "can't fork sort-last worker " << rank << "\n";
+      for (const pid_t child : children) { kill(child, SIGKILL); }
+      for (const pid_t child : children) { waitpid(child, nullptr, 0); }
+      return false;
+    }
+    children.push_back(pid);
+  }
+
+  // polled rather than waitpid(-1) so other children of the process are left alone; the remaining workers would
+  // wait at the barrier forever if one of them dies, so they are killed then
+  bool workers_ok = true;
+  std::vector<pid_t> running = children;
+  while (!running.empty()) {
+    const auto finished = std::remove_if(running.begin(), running.end(), [&](const pid_t child) {
+      int status = 0;
+      const pid_t result = waitpid(child, &status, WNOHANG);
+      if (0 == result) { return false; }
+      if (result < 0 || !WIFEXITED(status) || 0 != WEXITSTATUS(status)) { workers_ok = false; }
+      return true;
+    });
+    const bool progress = finished != running.end();
+    running.erase(finished, running.end());
+    if (!workers_ok) {
+      std::cerr << "a sort-last worker failed\n";
+      for (const pid_t child : running) { kill(child, SIGKILL); }
+      for (const pid_t child : running) { waitpid(child, nullptr, 0); }
+      break;
+    }
+    if (!progress) { std::this_thread::sleep_for(std::chrono::microseconds(100)); }
+  }
+  if (!workers_ok) { return false; }
+
+  const auto gather_start = std::chrono::steady_clock::now();
+  for (int rank = 0; rank < workers; ++rank) {
+    const auto [begin, end] = CompositeMethod::binary_swap == method ? binary_swap_region(rank, workers, pixels)
+                              : 0 == rank                            ? std::pair<std::size_t, std::size_t> { 0, pixels }
+                                                                     : std::pair<std::size_t, std::size_t> { 0, 0 };
+    std::memcpy(img.row(0) + (begin * bpp), frame.color(rank) + (begin * bpp), (end - begin) * bpp);
+    std::memcpy(zbuffer.row(0) + begin, frame.depth(rank) + begin, end - begin);
+  }
+  const auto wall_stop = std::chrono::steady_clock::now();
+
+  stats.workers = workers;
+  stats.method = method;
+  stats.render_seconds = 0.0;
+  stats.wait_seconds = 0.0;
+  stats.composite_seconds = 0.0;
+  for (int rank = 0; rank < workers; ++rank) {
+    stats.render_seconds = std::max(stats.render_seconds, frame.timing(rank).render_seconds);
+    stats.wait_seconds = std::max(stats.wait_seconds, frame.timing(rank).wait_seconds);
+    stats.composite_seconds = std::max(stats.composite_seconds, frame.timing(rank).composite_seconds);
+  }
+  stats.gather_seconds = std::chrono::duration<double>(wall_stop - gather_start).count();
+  stats.wall_seconds = std::chrono::duration<double>(wall_stop - wall_start).count();
+  stats.shared_bytes = frame.size();
+  return true;
+}
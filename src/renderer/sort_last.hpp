@@ -0,0 +1,45 @@
+#ifndef SORT_LAST_HPP
+#define SORT_LAST_HPP
+#include "tgaimage.hpp"
+#include "objreader.hpp"
+
+#include <cstddef>
+
+// Sort-last parallel rendering on one Linux machine: the faces of a screen space mesh are split into contiguous
+// ranges over forked worker processes, each renders its range into its own colour and depth buffers in a shared
+// memory mapping, and the buffers are merged per pixel by depth. A worker colours a face by its index in the whole
+// mesh, and where two workers hold the same depth the merge keeps the worker with the earlier faces, so neither the
+// worker count nor the composite method changes the frame.
+enum class CompositeMethod
+{
+  // log2(N) rounds, every worker composites half of its current region with a partner; N must be a power of two
+  binary_swap,
+  // log2(N) rounds of pairwise full-image merges towards worker 0, any N
+  tree
+};
+
+struct SortLastStats
+{
+  int workers = 0;
+  CompositeMethod method = CompositeMethod::tree;
+  // slowest worker for each phase
+  double render_seconds = 0.0;
+  // load imbalance: waiting at the barrier between rendering and compositing for the slowest renderer
+  double wait_seconds = 0.0;
+  double composite_seconds = 0.0;
+  // copying the composited regions into the output image
+  double gather_seconds = 0.0;
+  // from the first fork to the gathered image
+  double wall_seconds = 0.0;
+  std::size_t shared_bytes = 0;
+};
+
+// binary_swap falls back to tree when workers is not a power of two
+bool render_sort_last(const OBJObject<float> &screen_mesh,
+  const int workers,
+  CompositeMethod method,
+  TGAImage &img,
+  TGAImage &zbuffer,
+  SortLastStats &stats);
+
+#endif //SORT_LAST_HPP
@@ -0,0 +1,357 @@
+#include "streaming.hpp"
+#include "deferred.hpp"
+#include "rasterizer.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <stop_token>
+#include <string_view>
+#include <thread>
+
+namespace {
+
+constexpr std::array<char, 8> binary_magic = { 'B', 'R', 'M', 'E', 'S', 'H', '\0', '\0' };
+constexpr std::uint32_t binary_version = 1;
+// vertices fetched from the spill file with one read when their indices are this close
+constexpr std::size_t spill_window_vertices = 1024;
+
+static_assert(sizeof(OBJVertex<float>) == 3 * sizeof(float), "vertices are read and written raw");
+static_assert(sizeof(OBJFaceElements) == 3 * sizeof(std::int32_t), "faces are read and written raw");
+
+struct BinaryHeader
+{
+  std::array<char, 8> magic = binary_magic;
+  std::uint32_t version = binary_version;
+  std::uint32_t chunk_count = 0;
+  std::uint64_t face_count = 0;
+};
+
+struct BinaryChunkHeader
+{
+  std::uint32_t vertex_count = 0;
+  std::uint32_t face_count = 0;
+};
+
+std::string_view skip_blanks(std::string_view text)
+{
+  const std::size_t first = text.find_first_not_of(" \t\r");
+  return std::string_view::npos == first ? std::string_view {} : text.substr(first);
+}
+
+std::size_t chunk_bytes_for(const std::size_t vertex_count, const std::size_t face_count)
+{
+  return (vertex_count * sizeof(OBJVertex<float>)) + (face_count * sizeof(OBJFaceElements));
+}
+
+void update_peak(std::atomic<std::size_t> &peak, const std::size_t value)
+{
+  std::size_t current = peak.load();
+  while (current < value && !peak.compare_exchange_weak(current, value)) {}
+}
+
+}// namespace
+
+std::size_t MeshChunk::memory_bytes() const
+{
+  return chunk_bytes_for(mesh.vertices.capacity(), mesh.faces.capacity());
+}
+
+std::size_t MeshChunkReader::faces_per_chunk(const std::size_t chunk_bytes)
+{
+  // three unique vertices per face, plus the reader's two index arrays
+  return std::max<std::size_t>(1, chunk_bytes / (chunk_bytes_for(3, 1) + (6 * sizeof(std::uint32_t))));
+}
+
+std::size_t MeshChunkReader::memory_bytes() const
+{
+  return ((corners.capacity() + unique_corners.capacity()) * sizeof(std::uint32_t))
+         + (spill_window.capacity() * sizeof(std::array<float, 3>)) + line.capacity();
+}
+
+bool MeshChunkReader::open(const std::filesystem::path &mesh_path, const std::size_t chunk_bytes)
+{
+  in = std::ifstream(mesh_path, std::ios::binary);
+  if (!in.is_open()) {
+    std::cerr << "can't open mesh " << mesh_path << "\n";
+    return false;
+  }
+  error = false;
+  faces_read = 0;
+  chunk_bytes_max = chunk_bytes;
+  chunk_capacity = faces_per_chunk(chunk_bytes);
+
+  BinaryHeader header {};
+  in.read(reinterpret_cast<char *>(&header), sizeof(header));
+  binary = in.good() && header.magic == binary_magic;
+  if (binary) {
+    if (header.version == std::byteswap(binary_version)) {
+      std::cerr << mesh_path << " was written on a host with the other byte order, convert it again from the OBJ file\n";
+      return false;
+    }
+    if (header.version != binary_version) {
+      std::cerr << "unsupported binary mesh version " << header.version << " in " << mesh_path << "\n";
+      return false;
+    }
+    chunks_left = header.chunk_count;
+    return true;
+  }
+
+  in.clear();
+  in.seekg(0);
+  spill.reset(std::tmpfile());
+  if (!spill) {
+    std::cerr << "can't create a vertex spill file for " << mesh_path << "\n";
+    return false;
+  }
+  spilled_vertices = 0;
+  corners.clear();
+  corners.reserve(chunk_capacity * 3);
+  unique_corners.clear();
+  unique_corners.reserve(chunk_capacity * 3);
+  spill_window.resize(spill_window_vertices);
+  return true;
+}
+
+bool MeshChunkReader::next(MeshChunk &chunk)
+{
+  if (error) { return false; }
+  return binary ? next_binary(chunk) : next_obj(chunk);
+}
+
+bool MeshChunkReader::next_binary(MeshChunk &chunk)
+{
+  if (0 == chunks_left) { return false; }
+  --chunks_left;
+  BinaryChunkHeader header {};
+  in.read(reinterpret_cast<char *>(&header), sizeof(header));
+  if (!in.good()) {
+    std::cerr << "binary mesh is truncated\n";
+    error = true;
+    return false;
+  }
+  if (chunk_bytes_for(header.vertex_count, header.face_count) > chunk_bytes_max) {
+    std::cerr << "binary mesh chunk of " << chunk_bytes_for(header.vertex_count, header.face_count)
+              << " bytes exceeds the chunk budget of " << chunk_bytes_max << " bytes, convert it with smaller chunks\n";
+    error = true;
+    return false;
+  }
+  chunk.mesh = {};
+  chunk.mesh.vertices.resize(header.vertex_count);
+  chunk.mesh.faces.resize(header.face_count);
+  in.read(reinterpret_cast<char *>(chunk.mesh.vertices.data()), static_cast<std::streamsize>(header.vertex_count * sizeof(OBJVertex<float>)));
+  in.read(reinterpret_cast<char *>(chunk.mesh.faces.data()), static_cast<std::streamsize>(header.face_count * sizeof(OBJFaceElements)));
+  const bool valid = std::all_of(chunk.mesh.faces.begin(), chunk.mesh.faces.end(), [&](const OBJFaceElements &face) {
+    return std::all_of(face.face_vertices.begin(), face.face_vertices.end(), [&](const int vertex) {
+      return vertex >= 1 && static_cast<std::uint32_t>(vertex) <= header.vertex_count;
+    });
+  });
+  if (!in.good() || !valid) {
+    std::cerr << "binary mesh chunk is corrupt\n";
+    error = true;
+    return false;
+  }
+  chunk.first_face = faces_read;
+  faces_read += chunk.mesh.faces.size();
+  return true;
+}
+
+bool MeshChunkReader::next_obj(MeshChunk &chunk)
+{
+  corners.clear();
+  while (corners.size() < chunk_capacity * 3 && std::getline(in, line, '\n')) {
+    // same tokenization as read_obj: the symbol ends at the first space
+    const std::size_t symbol_end = line.find_first_of(' ');
+    if (std::string::npos == symbol_end) { continue; }
+    const std::string_view symbol = std::string_view(line).substr(0, symbol_end);
+    std::string_view rest = std::string_view(line).substr(symbol_end);
+
+    if ("v" == symbol) {
+      std::array<float, 3> position {};
+      for (auto &coord : position) {
+        rest = skip_blanks(rest);
+        const auto result = std::from_chars(rest.data(), rest.data() + rest.size(), coord);
+        if (std::errc {} != result.ec) {
+          std::cerr << "vertex has fewer than three coordinates: " << line << "\n";
+          error = true;
+          return false;
+        }
+        rest.remove_prefix(static_cast<std::size_t>(result.ptr - rest.data()));
+      }
+      // the spill file is positioned at its end, see read_spilled_vertices
+      if (1 != std::fwrite(position.data(), sizeof(position), 1, spill.get())) {
+        std::cerr << "can't write the vertex spill file\n";
+        error = true;
+        return false;
+      }
+      ++spilled_vertices;
+    } else if ("f" == symbol) {
+      // corners are v, v/vt, v//vn or v/vt/vn; only the vertex of the first three corners is used
+      for (int corner = 0; corner < 3; ++corner) {
+        rest = skip_blanks(rest);
+        long index = 0;
+        const auto result = std::from_chars(rest.data(), rest.data() + rest.size(), index);
+        const std::size_t token_end = rest.find_first_of(" \t\r");
+        rest.remove_prefix(std::string_view::npos == token_end ? rest.size() : token_end);
+        // negative indices count back from the last vertex read
+        if (index < 0) { index += static_cast<long>(spilled_vertices) + 1; }
+        if (std::errc {} != result.ec || index < 1 || static_cast<std::size_t>(index) > spilled_vertices) {
+          std::cerr << "face references an undefined vertex: " << line << "\n";
+          error = true;
+          return false;
+        }
+        corners.push_back(static_cast<std::uint32_t>(index - 1));
+      }
+    }
+  }
+  if (corners.empty()) { return false; }
+
+  unique_corners.assign(corners.begin(), corners.end());
+  std::sort(unique_corners.begin(), unique_corners.end());
+  unique_corners.erase(std::unique(unique_corners.begin(), unique_corners.end()), unique_corners.end());
+
+  chunk.mesh = {};
+  chunk.mesh.vertices.resize(unique_corners.size());
+  if (!read_spilled_vertices(unique_corners, chunk.mesh.vertices)) { return false; }
+  const std::size_t face_count = corners.size() / 3;
+  chunk.mesh.faces.reserve(face_count);
+  const auto local_index = [&](const std::uint32_t global) {
+    return static_cast<int>(std::lower_bound(unique_corners.begin(), unique_corners.end(), global) - unique_corners.begin()) + 1;
+  };
+  for (std::size_t face = 0; face < face_count; ++face) {
+    chunk.mesh.faces.emplace_back(local_index(corners[face * 3]), local_index(corners[(face * 3) + 1]), local_index(corners[(face * 3) + 2]));
+  }
+  chunk.first_face = faces_read;
+  faces_read += face_count;
+  return true;
+}
+
+bool MeshChunkReader::read_spilled_vertices(std::span<const std::uint32_t> sorted_indices, std::vector<OBJVertex<float>> &vertices)
+{
+  std::size_t first = 0;
+  while (first < sorted_indices.size()) {
+    // one read for a run of nearby indices
+    const std::uint32_t window_start = sorted_indices[first];
+    std::size_t last = first;
+    while (last + 1 < sorted_indices.size() && sorted_indices[last + 1] - window_start < spill_window_vertices) { ++last; }
+    const std::size_t window_count = sorted_indices[last] - window_start + 1;
+    const auto offset = static_cast<long>(window_start * sizeof(std::array<float, 3>));
+    if (0 != std::fseek(spill.get(), offset, SEEK_SET)
+        || window_count != std::fread(spill_window.data(), sizeof(std::array<float, 3>), window_count, spill.get())) {
+      std::cerr << "can't read the vertex spill file\n";
+      error = true;
+      return false;
+    }
+    for (std::size_t index = first; index <= last; ++index) {
+      vertices[index].vertex_coords = spill_window[sorted_indices[index] - window_start];
+    }
+    first = last + 1;
+  }
+  // back to the end for the vertices parsed next; a stream switching from reading to writing needs a seek anyway
+  if (0 != std::fseek(spill.get(), 0, SEEK_END)) {
+    std::cerr << "can't seek the vertex spill file\n";
+    error = true;
+    return false;
+  }
+  return true;
+}
+
+bool convert_to_binary_mesh(const std::filesystem::path &mesh_path, const std::filesystem::path &binary_path, const std::size_t chunk_bytes)
+{
+  MeshChunkReader reader;
+  if (!reader.open(mesh_path, chunk_bytes)) { return false; }
+  std::ofstream out(binary_path, std::ios::binary);
+  if (!out.is_open()) {
+    std::cerr << "can't open " << binary_path << "\n";
+    return false;
+  }
+  BinaryHeader header {};
+  out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  MeshChunk chunk {};
+  while (reader.next(chunk)) {
+    const BinaryChunkHeader chunk_header { static_cast<std::uint32_t>(chunk.mesh.vertices.size()), static_cast<std::uint32_t>(chunk.mesh.faces.size()) };
+    out.write(reinterpret_cast<const char *>(&chunk_header), sizeof(chunk_header));
+    out.write(reinterpret_cast<const char *>(chunk.mesh.vertices.data()), static_cast<std::streamsize>(chunk.mesh.vertices.size() * sizeof(OBJVertex<float>)));
+    out.write(reinterpret_cast<const char *>(chunk.mesh.faces.data()), static_cast<std::streamsize>(chunk.mesh.faces.size() * sizeof(OBJFaceElements)));
+    ++header.chunk_count;
+    header.face_count += chunk.mesh.faces.size();
+  }
+  if (reader.failed()) { return false; }
+  out.seekp(0);
+  out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  return out.good();
+}
+
+bool render_streaming(const std::filesystem::path &mesh_path,
+  const StreamOptions &options,
+  TGAImage &img,
+  TGAImage &zbuffer,
+  StreamStats &stats)
+{
+  MeshChunkReader reader;
+  if (!reader.open(mesh_path, options.chunk_bytes())) { return false; }
+
+  std::mutex queue_mutex;
+  std::condition_variable_any queue_changed;
+  std::deque<MeshChunk> queue;
+  bool reader_done = false;
+  std::atomic<std::size_t> live_bytes { 0 };
+  std::atomic<std::size_t> peak_bytes { reader.memory_bytes() };
+  double read_seconds = 0.0;
+
+  const auto render_start = std::chrono::steady_clock::now();
+  std::jthread io_thread([&](const std::stop_token &stop) {
+    while (!stop.stop_requested()) {
+      MeshChunk chunk {};
+      const auto read_start = std::chrono::steady_clock::now();
+      const bool got_chunk = reader.next(chunk);
+      read_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - read_start).count();
+      if (!got_chunk) { break; }
+      // reader scratch is counted on top, its line buffer can still grow after open
+      update_peak(peak_bytes, live_bytes.fetch_add(chunk.memory_bytes()) + chunk.memory_bytes() + reader.memory_bytes());
+      std::unique_lock lock(queue_mutex);
+      if (!queue_changed.wait(lock, stop, [&] { return queue.size() < options.prefetch_chunks; })) { break; }
+      queue.push_back(std::move(chunk));
+      queue_changed.notify_all();
+    }
+    const std::scoped_lock lock(queue_mutex);
+    reader_done = true;
+    queue_changed.notify_all();
+  });
+
+  while (true) {
+    MeshChunk chunk {};
+    {
+      const auto wait_start = std::chrono::steady_clock::now();
+      std::unique_lock lock(queue_mutex);
+      queue_changed.wait(lock, [&] { return !queue.empty() || reader_done; });
+      stats.wait_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - wait_start).count();
+      if (queue.empty()) { break; }
+      chunk = std::move(queue.front());
+      queue.pop_front();
+      queue_changed.notify_all();
+    }
+    const std::size_t chunk_bytes = chunk.memory_bytes();
+    chunk.mesh.viewport_transform(img);
+    shade_forward(img, zbuffer, chunk.mesh.vertices, chunk.mesh.faces, [&](const std::size_t face, float, float, float) {
+      return face_color(chunk.first_face + face);
+    });
+    ++stats.chunks;
+    stats.faces += chunk.mesh.faces.size();
+    chunk = {};
+    live_bytes -= chunk_bytes;
+  }
+  io_thread.join();
+
+  stats.render_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - render_start).count();
+  stats.read_seconds += read_seconds;
+  stats.peak_bytes = std::max(stats.peak_bytes, peak_bytes.load());
+  return !reader.failed();
+}
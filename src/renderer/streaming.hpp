@@ -0,0 +1,103 @@
+#ifndef STREAMING_HPP
+#define STREAMING_HPP
+#include "tgaimage.hpp"
+#include "objreader.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+// Out-of-core rendering: the mesh is read in self-contained chunks of bounded size, each chunk is transformed and
+// rasterized into the persistent colour and depth buffers and freed again. Chunks are rasterized in file order and a
+// chunk's faces are shaded face_color(first_face + local index), so the frame does not depend on where the file is
+// cut into chunks or on the memory budget.
+
+// Local vertices and faces indexing them (1-based, like OBJ), plus the index of the first face in the whole mesh.
+struct MeshChunk
+{
+  OBJObject<float> mesh;
+  std::size_t first_face = 0;
+
+  [[nodiscard]] std::size_t memory_bytes() const;
+};
+
+// Binary mesh file, all values in the byte order of the host that wrote it (a file from a host with the other byte
+// order is rejected by open()):
+//   header   "BRMESH\0\0", uint32 version, uint32 chunk count, uint64 face count
+//   chunks   uint32 vertex count, uint32 face count, float x/y/z per vertex, int32 x 3 per face (1-based, local)
+// Chunks are self-contained, so a reader never needs more than one chunk in memory.
+class MeshChunkReader
+{
+public:
+  // chunk_bytes bounds MeshChunk::memory_bytes() of every chunk returned; the format is detected from the file
+  bool open(const std::filesystem::path &mesh_path, const std::size_t chunk_bytes);
+  // false at the end of the mesh or on an error, see failed()
+  bool next(MeshChunk &chunk);
+
+  [[nodiscard]] bool failed() const { return error; }
+  [[nodiscard]] bool is_binary() const { return binary; }
+  // bytes of scratch memory the reader holds besides the chunks it returns
+  [[nodiscard]] std::size_t memory_bytes() const;
+  // OBJ faces per chunk so that chunk and reader scratch stay within chunk_bytes even with three unique vertices each
+  [[nodiscard]] static std::size_t faces_per_chunk(const std::size_t chunk_bytes);
+
+private:
+  bool next_obj(MeshChunk &chunk);
+  bool next_binary(MeshChunk &chunk);
+  bool read_spilled_vertices(std::span<const std::uint32_t> sorted_indices, std::vector<OBJVertex<float>> &vertices);
+
+  std::ifstream in;
+  bool binary = false;
+  bool error = false;
+  std::size_t chunk_bytes_max = 0;
+  std::size_t chunk_capacity = 0;
+  std::size_t faces_read = 0;
+  std::uint32_t chunks_left = 0;
+
+  // OBJ: positions are spilled to a temporary file as they are parsed and looked up per chunk
+  std::unique_ptr<std::FILE, int (*)(std::FILE *)> spill { nullptr, &std::fclose };
+  std::size_t spilled_vertices = 0;
+  std::string line;
+  std::vector<std::uint32_t> corners;
+  std::vector<std::uint32_t> unique_corners;
+  std::vector<std::array<float, 3>> spill_window;
+};
+
+// converts any mesh MeshChunkReader can read into the binary format, with chunks of at most chunk_bytes
+bool convert_to_binary_mesh(const std::filesystem::path &mesh_path, const std::filesystem::path &binary_path, const std::size_t chunk_bytes);
+
+struct StreamOptions
+{
+  // mesh bytes in flight: the chunk being read, prefetched chunks and the chunk being rasterized
+  std::size_t memory_budget = std::size_t { 64 } * 1024 * 1024;
+  std::size_t prefetch_chunks = 2;
+
+  [[nodiscard]] std::size_t chunk_bytes() const { return memory_budget / (prefetch_chunks + 2); }
+};
+
+struct StreamStats
+{
+  std::size_t chunks = 0;
+  std::size_t faces = 0;
+  // largest sum of live chunks plus reader scratch memory
+  std::size_t peak_bytes = 0;
+  double read_seconds = 0.0;
+  double wait_seconds = 0.0;
+  double render_seconds = 0.0;
+};
+
+// chunks are read on an I/O thread while the calling thread rasterizes
+bool render_streaming(const std::filesystem::path &mesh_path,
+  const StreamOptions &options,
+  TGAImage &img,
+  TGAImage &zbuffer,
+  StreamStats &stats);
+
+#endif //STREAMING_HPP
@@ -2,6 +2,7 @@
 #include <cstring>
 #include <span>
 #include <cstdint>
+#include <cstddef>
 #include <fstream>
 #include "tgaimage.hpp"
 #include <string>
@@ -9,17 +10,14 @@
 #include <array>
 #include <string_view>
 #include <bit>
+#include <algorithm>
 
 TGAImage::TGAImage(const int width, const int height, const int bpp, TGAColor color)
   : w(width), h(height), bpp(bpp)
 {
   auto data_size = static_cast<std::size_t>(w * h * static_cast<int>(bpp));
   data = std::vector<std::uint8_t>(data_size, 0);
-  for (int j=0; j<height; j++){
-	for (int i=0; i<width; i++){
-            set(i, j, color);
-	}
-  }
+  clear(color);
 }
 
  TGAColor::TGAColor(std::uint8_t blue, std::uint8_t green, std::uint8_t red, std::uint8_t alpha)
@@ -142,60 +140,53 @@ bool TGAImage::load_rle_data(std::ifstream &instream) {
 
 bool TGAImage::write_tga_file(const std::string& filename, const bool vflip, const bool rle) const
 {
-  constexpr std::array<std::uint8_t, 4> developer_area_ref = { 0, 0, 0, 0 };
-  constexpr std::array<std::uint8_t, 4> extension_area_ref = { 0, 0, 0, 0 };
-  constexpr std::array<std::uint8_t, 18> footer = {
-    'T', 'R', 'U', 'E', 'V', 'I', 'S', 'I', 'O', 'N', '-', 'X', 'F', 'I', 'L', 'E', '.', '\0'
-  };
+  std::vector<std::uint8_t> bytes {};
+  encode_tga(bytes, vflip, rle);
   std::ofstream out;
   out.open(filename, std::ios::binary);
   if (!out.is_open()) {
     std::cerr << "can't open file " << filename << "\n";
     return false;
   }
+  out.write(reinterpret_cast<const char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+  if (!out.good()) {
+    std::cerr << "can't dump the tga file\n";
+    return false;
+  }
+  return true;
+}
+
+void TGAImage::encode_tga(std::vector<std::uint8_t> &out, const bool vflip, const bool rle) const
+{
+  constexpr std::array<std::uint8_t, 4> developer_area_ref = { 0, 0, 0, 0 };
+  constexpr std::array<std::uint8_t, 4> extension_area_ref = { 0, 0, 0, 0 };
+  constexpr std::array<std::uint8_t, 18> footer = {
+    'T', 'R', 'U', 'E', 'V', 'I', 'S', 'I', 'O', 'N', '-', 'X', 'F', 'I', 'L', 'E', '.', '\0'
+  };
   TGAHeader header = {};
   header.bitsperpixel = bpp << static_cast<uint8_t>(3);
   header.width = static_cast<uint16_t>(w);
   header.height = static_cast<uint16_t>(h);
   header.datatypecode = (bpp == GRAYSCALE ? (rle ? Datatypecode::COMPRESSED_WB : Datatypecode::UNCOMPRESSED_WB) : (rle ? Datatypecode::RLE_RGB : Datatypecode::UNCOMPRESSED_RGB));
   header.imagedescriptor = vflip ? Imagedescriptor::BOTTOM_LEFT : Imagedescriptor::TOP_LEFT;// top-left or bottom-left origin
-  out.write(reinterpret_cast<const char *>(&header), sizeof(header));
-  if (!out.good()) {
-    std::cerr << "can't dump the tga file\n";
-    return false;
-  }
+  out.clear();
+  // worst case of the RLE encoding is one packet header per pixel; reserving it up front means a buffer reused for
+  // images of one size never grows again
+  const auto npixels = static_cast<std::size_t>(w) * static_cast<std::size_t>(h);
+  out.reserve(sizeof(header) + (npixels * (static_cast<std::size_t>(bpp) + 1)) + developer_area_ref.size() + extension_area_ref.size() + footer.size());
+  const auto *header_bytes = reinterpret_cast<const std::uint8_t *>(&header);
+  out.insert(out.end(), header_bytes, header_bytes + sizeof(header));
   if (!rle) {
-    const std::span<const uint8_t> data_span(data);
-    auto bytes = std::as_bytes(data_span);
-    // out.write(reinterpret_cast<const char *>(data.data()), w*h*bpp);
-    out.write(std::bit_cast<const char *>(bytes.data()), w * h * bpp);
-    if (!out.good()) {
-      std::cerr << "can't dump the tga file\n";
-      return false;
-    }
-  } else if (!unload_rle_data(out)) {
-    std::cerr << "can't dump the tga file\n";
-    return false;
+    out.insert(out.end(), data.begin(), data.end());
+  } else {
+    unload_rle_data(out);
   }
-  out.write(reinterpret_cast<const char *>(developer_area_ref.data()), sizeof(developer_area_ref));
-  if (!out.good()) {
-    std::cerr << "can't dump the tga file\n";
-    return false;
-  }
-  out.write(reinterpret_cast<const char *>(extension_area_ref.data()), sizeof(extension_area_ref));
-  if (!out.good()) {
-    std::cerr << "can't dump the tga file\n";
-    return false;
-  }
-  out.write(reinterpret_cast<const char *>(footer.data()), sizeof(footer));
-  if (!out.good()) {
-    std::cerr << "can't dump the tga file\n";
-    return false;
-  }
-  return true;
+  out.insert(out.end(), developer_area_ref.begin(), developer_area_ref.end());
+  out.insert(out.end(), extension_area_ref.begin(), extension_area_ref.end());
+  out.insert(out.end(), footer.begin(), footer.end());
 }
 
-bool TGAImage::unload_rle_data(std::ofstream &out) const {
+void TGAImage::unload_rle_data(std::vector<std::uint8_t> &out) const {
     const std::uint8_t max_chunk_length = 128;
     const auto npixels = static_cast<size_t>(w*h);
     size_t curpix = 0;
@@ -223,12 +214,10 @@ bool TGAImage::unload_rle_data(std::ofstream &out) const {
             run_length++;
         }
         curpix += run_length;
-        out.put(raw ? run_length-1 : run_length+max_chunk_length-1);
-        if (!out.good()) {return false;}
-        out.write(reinterpret_cast<const char *>(data.data()+chunkstart), (raw?run_length*bpp:bpp));
-        if (!out.good()) {return false;}
+        out.push_back(static_cast<std::uint8_t>(raw ? run_length-1 : run_length+max_chunk_length-1));
+        const auto chunk = data.begin() + static_cast<std::ptrdiff_t>(chunkstart);
+        out.insert(out.end(), chunk, chunk + (raw?run_length*bpp:bpp));
     }
-    return true;
 }
 
 TGAColor TGAImage::get(const int x, const int y) const {
@@ -266,6 +255,14 @@ void TGAImage::flip_vertically() {
   }
 }
 
+void TGAImage::clear(const TGAColor &color) {
+  if (data.empty()) {return;}
+  memcpy(data.data(), color.bgra, bpp);
+  for (std::size_t filled = bpp; filled < data.size(); filled *= 2) {
+    memcpy(data.data()+filled, data.data(), std::min(filled, data.size()-filled));
+  }
+}
+
 int TGAImage::width() const {
     return w;
 }
@@ -274,3 +271,15 @@ int TGAImage::height() const {
     return h;
 }
 
+int TGAImage::bytes_per_pixel() const {
+    return bpp;
+}
+
+std::uint8_t *TGAImage::row(const int y) {
+    return data.data()+(static_cast<std::size_t>(y)*static_cast<std::size_t>(w)*bpp);
+}
+
+const std::uint8_t *TGAImage::row(const int y) const {
+    return data.data()+(static_cast<std::size_t>(y)*static_cast<std::size_t>(w)*bpp);
+}
+
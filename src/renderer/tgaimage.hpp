@@ -42,15 +42,22 @@ struct TGAImage {
     TGAImage(const int w, const int h, const int bpp, TGAColor c = {});
     bool  read_tga_file(const std::string& filename);
     bool write_tga_file(const std::string& filename, const bool vflip=true, const bool rle=true) const;
+    // the complete file write_tga_file writes; out is cleared first and keeps its capacity
+    void encode_tga(std::vector<std::uint8_t> &out, const bool vflip=true, const bool rle=true) const;
     void flip_horizontally();
     void flip_vertically();
+    void clear(const TGAColor &c = {});
     TGAColor get(const int x, const int y) const;
     void set(const int x, const int y, const TGAColor &c);
     int width()  const;
     int height() const;
+    int bytes_per_pixel() const;
+    // raw access to row y, bytes_per_pixel() bytes per pixel; no bounds checks
+    std::uint8_t *row(const int y);
+    const std::uint8_t *row(const int y) const;
 private:
     bool   load_rle_data(std::ifstream &in);
-    bool unload_rle_data(std::ofstream &out) const;
+    void unload_rle_data(std::vector<std::uint8_t> &out) const;
     int w = 0, h = 0;
     std::uint8_t bpp = 0;
     std::vector<std::uint8_t> data = {};
@@ -0,0 +1,145 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "batch.hpp"
+#include "frame_memory.hpp"
+#include "objreader.hpp"
+#include "tgaimage.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+const std::filesystem::path test_dir = std::filesystem::temp_directory_path() / "bloatedrenderer_batch_test";
+
+std::filesystem::path write_file(const std::string &name, const std::string &contents)
+{
+  std::filesystem::create_directories(test_dir);
+  const auto path = test_dir / name;
+  std::ofstream out(path);
+  out << contents;
+  return path;
+}
+
+std::vector<char> file_bytes(const std::filesystem::path &path)
+{
+  std::ifstream in(path, std::ios::binary);
+  return { std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>() };
+}
+
+// a tetrahedron in normalized device coordinates
+constexpr const char *tetrahedron = "v -0.5 -0.5 -0.5\nv 0.5 -0.5 -0.5\nv 0 0.5 -0.5\nv 0 0 0.5\n"
+                                    "f 1 2 3\nf 1 2 4\nf 2 3 4\nf 3 1 4\n";
+
+}// namespace
+
+TEST_CASE("Output patterns expand model and zero padded frame", "[batch]")
+{
+  REQUIRE(expand_output_pattern("out/{model}_{frame}.tga", "head", 7) == "out/head_0007.tga");
+  REQUIRE(expand_output_pattern("{frame}/{frame}.tga", "head", 12) == "0012/0012.tga");
+  REQUIRE(expand_output_pattern("fixed.tga", "head", 3) == "fixed.tga");
+}
+
+TEST_CASE("Manifests are parsed and malformed lines rejected", "[batch]")
+{
+  BatchManifest manifest {};
+  const auto valid = write_file("valid.txt",
+    "# turntable\n"
+    "model tet tet.obj\n"
+    "\n"
+    "job tet 64x48 4 0 90 15 frames/{model}_{frame}.tga # comment\n");
+  REQUIRE(read_manifest(valid, manifest));
+  REQUIRE(manifest.models.size() == 1);
+  REQUIRE(manifest.models[0].path == test_dir / "tet.obj");
+  REQUIRE(manifest.jobs.size() == 1);
+  REQUIRE(manifest.jobs[0].width == 64);
+  REQUIRE(manifest.jobs[0].height == 48);
+  REQUIRE(manifest.jobs[0].frames == 4);
+  REQUIRE(manifest.jobs[0].yaw_end == 90.0F);
+  REQUIRE(manifest.jobs[0].output_pattern == "frames/{model}_{frame}.tga");
+
+  for (const char *malformed : { "model tet\n",
+         "model tet tet.obj\njob tet 64 4 0 90 15 out.tga\n",
+         "model tet tet.obj\njob tet 64x0 4 0 90 15 out.tga\n",
+         "model tet tet.obj\njob tet 64x48 0 0 90 15 out.tga\n",
+         "model tet tet.obj\njob tet 64x48 4 0 90\n",
+         "job tet 64x48 4 0 90 15 out.tga\n",
+         "camera 1 2 3\n" }) {
+    BatchManifest rejected {};
+    REQUIRE_FALSE(read_manifest(write_file("malformed.txt", malformed), rejected));
+  }
+  BatchManifest missing {};
+  REQUIRE_FALSE(read_manifest(test_dir / "does_not_exist.txt", missing));
+}
+
+TEST_CASE("A batch writes every frame deterministically", "[batch]")
+{
+  write_file("tet.obj", tetrahedron);
+  BatchManifest manifest {};
+  REQUIRE(read_manifest(write_file("turntable.txt",
+                          "model tet tet.obj\n"
+                          "job tet 32x32 3 0 90 20 "
+                            + (test_dir / "first/{model}_{frame}.tga").string() + "\n"
+                            + "job tet 32x32 3 0 90 20 " + (test_dir / "second/{model}_{frame}.tga").string() + "\n"),
+    manifest));
+
+  BatchStats stats {};
+  REQUIRE(run_batch(manifest, 2, stats));
+  REQUIRE(stats.frames == 6);
+  REQUIRE(stats.triangles == 24);
+  for (int frame = 0; frame < 3; ++frame) {
+    const auto first = test_dir / expand_output_pattern("first/{model}_{frame}.tga", "tet", frame);
+    const auto second = test_dir / expand_output_pattern("second/{model}_{frame}.tga", "tet", frame);
+    TGAImage img {};
+    REQUIRE(img.read_tga_file(first.string()));
+    REQUIRE(img.width() == 32);
+    REQUIRE(img.height() == 32);
+    REQUIRE(file_bytes(first) == file_bytes(second));
+  }
+  std::filesystem::remove_all(test_dir);
+}
+
+TEST_CASE("A frame that can't be written fails the batch", "[batch]")
+{
+  write_file("tet.obj", tetrahedron);
+  // the output directory is an existing regular file
+  const auto blocker = write_file("blocker", "");
+  BatchManifest manifest {};
+  REQUIRE(read_manifest(
+    write_file("blocked.txt", "model tet tet.obj\njob tet 16x16 2 0 90 0 " + (blocker / "{frame}.tga").string() + "\n"),
+    manifest));
+  BatchStats stats {};
+  REQUIRE_FALSE(run_batch(manifest, 1, stats));
+
+  BatchManifest unwritable {};
+  REQUIRE(read_manifest(
+    write_file("unwritable.txt", "model tet tet.obj\njob tet 16x16 2 0 90 0 " + test_dir.string() + "/\n"), unwritable));
+  REQUIRE_FALSE(run_batch(unwritable, 1, stats));
+  std::filesystem::remove_all(test_dir);
+}
+
+TEST_CASE("Faces with undefined vertices are rejected, not read out of bounds", "[batch]")
+{
+  for (const std::string face : { "f 1 2 5\n", "f 0 1 2\n", "f -1 2 3\n" }) {
+    OBJObject<float> mesh {};
+    REQUIRE_FALSE(read_obj(write_file("bad.obj", std::string(tetrahedron) + face), mesh));
+  }
+  BatchManifest manifest {};
+  REQUIRE(read_manifest(
+    write_file("bad.txt", "model bad bad.obj\njob bad 16x16 1 0 0 0 " + (test_dir / "bad.tga").string() + "\n"), manifest));
+  BatchStats stats {};
+  REQUIRE_FALSE(run_batch(manifest, 1, stats));
+
+  // meshes built in code skip read_obj; the renderer's lookups still throw instead of reading past the vertices
+  OBJObject<float> mesh {};
+  mesh.vertices.emplace_back(0.0F, 0.0F, 0.0F);
+  mesh.faces.emplace_back(1, 1, 2);
+  FrameResources resources {};
+  std::string output_path {};
+  REQUIRE_THROWS_AS(render_batch_frame(manifest.jobs.front(), 0, mesh, resources, output_path), std::out_of_range);
+  std::filesystem::remove_all(test_dir);
+}
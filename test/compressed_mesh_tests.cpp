@@ -0,0 +1,204 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "compressed_mesh.hpp"
+#include "frame_memory.hpp"
+#include "objreader.hpp"
+#include "rasterizer.hpp"
+#include "render_test_helpers.hpp"
+#include "tgaimage.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+
+TEST_CASE("Half floats round trip exactly, including denormals and infinities", "[compressed_mesh]")
+{
+  REQUIRE(float_to_half(1.0F) == 0x3C00U);
+  REQUIRE(float_to_half(-2.0F) == 0xC000U);
+  REQUIRE(float_to_half(65504.0F) == 0x7BFFU);
+  // above the largest half, rounding overflows to infinity
+  REQUIRE(float_to_half(65520.0F) == 0x7C00U);
+  REQUIRE(float_to_half(std::numeric_limits<float>::infinity()) == 0x7C00U);
+  REQUIRE(float_to_half(-std::numeric_limits<float>::infinity()) == 0xFC00U);
+  REQUIRE(std::isinf(half_to_float(0x7C00U)));
+  REQUIRE(half_to_float(0xFC00U) < 0.0F);
+  REQUIRE(std::isnan(half_to_float(float_to_half(std::numeric_limits<float>::quiet_NaN()))));
+  REQUIRE(float_to_half(-0.0F) == 0x8000U);
+
+  // denormals: the smallest one, ties to even below it and the largest one
+  const float smallest = std::ldexp(1.0F, -24);
+  REQUIRE(float_to_half(smallest) == 0x0001U);
+  REQUIRE(float_to_half(0.5F * smallest) == 0x0000U);
+  REQUIRE(float_to_half(1.5F * smallest) == 0x0002U);
+  REQUIRE(float_to_half(1023.0F * smallest) == 0x03FFU);
+  REQUIRE(half_to_float(0x0001U) == smallest);
+  REQUIRE(half_to_float(0x03FFU) == 1023.0F * smallest);
+
+  // every half that is not a NaN survives half -> float -> half unchanged
+  for (std::uint32_t half = 0; half <= 0xFFFFU; ++half) {
+    const auto bits = static_cast<std::uint16_t>(half);
+    const float value = half_to_float(bits);
+    if (std::isnan(value)) { continue; }
+    REQUIRE(float_to_half(value) == bits);
+  }
+}
+
+TEST_CASE("Half float conversion rounds to within half a unit in the last place", "[compressed_mesh]")
+{
+  // relative error of round to nearest with a 10 bit mantissa
+  const float bound = std::ldexp(1.0F, -11);
+  TestRandom random(11);
+  for (int index = 0; index < 100000; ++index) {
+    const float mantissa = static_cast<float>(random.next(1U << 24U)) / 16777216.0F;
+    // normal halves span 2^-14 .. 65504
+    const float value = std::ldexp(1.0F + mantissa, static_cast<int>(random.next(29U)) - 14);
+    const float decoded = half_to_float(float_to_half(value));
+    REQUIRE(std::abs(decoded - value) <= bound * value);
+  }
+}
+
+TEST_CASE("Octahedral normals decode within the 16 bit error bound", "[compressed_mesh]")
+{
+  // rounding is half a snorm16 step per octahedral coordinate, which the unfolding onto the sphere stretches by up
+  // to a factor of about 4
+  constexpr float bound = 2.0F / 32767.0F;
+  constexpr int count = 20000;
+  float worst = 0.0F;
+  for (int index = 0; index < count; ++index) {
+    const auto normal = sphere_direction(index, count);
+    const auto decoded = decode_octahedral(encode_octahedral(normal));
+    const float length = std::sqrt((decoded[0] * decoded[0]) + (decoded[1] * decoded[1]) + (decoded[2] * decoded[2]));
+    REQUIRE(std::abs(length - 1.0F) < 1e-5F);
+    for (std::size_t axis = 0; axis < 3; ++axis) { worst = std::max(worst, std::abs(decoded.at(axis) - normal.at(axis))); }
+  }
+  REQUIRE(worst <= bound);
+
+  for (const std::array<float, 3> &axis : { std::array { 1.0F, 0.0F, 0.0F }, std::array { 0.0F, -1.0F, 0.0F }, std::array { 0.0F, 0.0F, -1.0F } }) {
+    const auto decoded = decode_octahedral(encode_octahedral(axis));
+    for (std::size_t component = 0; component < 3; ++component) { REQUIRE(std::abs(decoded.at(component) - axis.at(component)) < 1e-6F); }
+  }
+  // a degenerate normal still decodes to a unit vector
+  const auto zero = decode_octahedral(encode_octahedral({ 0.0F, 0.0F, 0.0F }));
+  REQUIRE(zero[0] == 0.0F);
+  REQUIRE(zero[1] == 0.0F);
+  REQUIRE(zero[2] == 1.0F);
+}
+
+TEST_CASE("Quantized positions are within half a step of the original", "[compressed_mesh]")
+{
+  OBJObject<float> mesh {};
+  TestRandom random(3);
+  const auto next = [&] { return (static_cast<float>(random.next(1U << 24U)) / 16777216.0F * 2.0F) - 1.0F; };
+  for (int index = 0; index < 3000; ++index) {
+    mesh.vertices.emplace_back(next() * 3.0F, next() * 0.01F, next() + 5.0F);
+    if (index % 3 == 2) { mesh.faces.emplace_back(index - 1, index, index + 1); }
+  }
+  const CompressedMesh compressed = compress_mesh(mesh);
+  std::array<float, 3> magnitude {};
+  for (std::size_t axis = 0; axis < 3; ++axis) {
+    REQUIRE(compressed.step.at(axis) > 0.0F);
+    for (const auto &vert : mesh.vertices) { magnitude.at(axis) = std::max(magnitude.at(axis), std::abs(vert.vertex_coords.at(axis))); }
+  }
+
+  for (const auto &vert : mesh.vertices) {
+    const auto decoded = compressed.decode_position(compressed.quantize_position(vert.vertex_coords));
+    for (std::size_t axis = 0; axis < 3; ++axis) {
+      // half a step, plus float rounding in quantize and decode
+      const float bound = (0.5F * compressed.step.at(axis)) + (4.0F * std::numeric_limits<float>::epsilon() * magnitude.at(axis));
+      REQUIRE(std::abs(decoded.at(axis) - vert.vertex_coords.at(axis)) <= bound);
+    }
+  }
+}
+
+TEST_CASE("Meshes are split into sub-meshes of at most 65536 vertices", "[compressed_mesh]")
+{
+  // disjoint triangles, so no vertex is shared and 90000 vertices do not fit one 16 bit sub-mesh
+  constexpr int triangles = 30000;
+  OBJObject<float> mesh {};
+  for (int index = 0; index < triangles; ++index) {
+    const float x_coord = static_cast<float>(index % 200) / 100.0F - 1.0F;
+    const float y_coord = static_cast<float>(index / 200) / 75.0F - 1.0F;
+    mesh.vertices.emplace_back(x_coord, y_coord, 0.0F);
+    mesh.vertices.emplace_back(x_coord + 0.01F, y_coord, 0.0F);
+    mesh.vertices.emplace_back(x_coord, y_coord + 0.01F, 0.0F);
+    mesh.faces.emplace_back((index * 3) + 1, (index * 3) + 2, (index * 3) + 3);
+  }
+  const CompressedMesh compressed = compress_mesh(mesh);
+  REQUIRE(compressed.submeshes.size() == 2);
+  REQUIRE(compressed.face_count() == triangles);
+  REQUIRE(compressed.vertex_count() == static_cast<std::size_t>(triangles) * 3);
+  for (const auto &submesh : compressed.submeshes) {
+    REQUIRE(submesh.positions.size() <= 65536);
+    REQUIRE(submesh.normals.size() == submesh.positions.size());
+    REQUIRE(submesh.uvs.size() == submesh.positions.size());
+    REQUIRE(std::all_of(submesh.indices.begin(), submesh.indices.end(), [&](const std::uint16_t index) { return index < submesh.positions.size(); }));
+  }
+
+  // with a small limit shared vertices are duplicated across sub-meshes and every face keeps its corners
+  const OBJObject<float> grid = make_grid_mesh(20);
+  const CompressedMesh split = compress_mesh(grid, 100);
+  REQUIRE(split.submeshes.size() > 1);
+  REQUIRE(split.face_count() == grid.faces.size());
+  REQUIRE(split.vertex_count() > grid.vertices.size());
+  std::size_t face_index = 0;
+  for (const auto &submesh : split.submeshes) {
+    REQUIRE(submesh.positions.size() <= 100);
+    for (std::size_t index = 0; index < submesh.indices.size(); ++index) {
+      const auto &source = grid.vertices[static_cast<std::size_t>(grid.faces[face_index + (index / 3)].face_vertices.at(index % 3) - 1)];
+      REQUIRE(submesh.positions[submesh.indices[index]] == split.quantize_position(source.vertex_coords));
+    }
+    face_index += submesh.indices.size() / 3;
+  }
+}
+
+TEST_CASE("The transform kernel decodes normals and uvs", "[compressed_mesh]")
+{
+  OBJObject<float> mesh {};
+  mesh.vertices.emplace_back(-1.0F, -1.0F, 0.0F);
+  mesh.vertices.emplace_back(1.0F, -1.0F, 0.0F);
+  mesh.vertices.emplace_back(1.0F, 1.0F, 0.0F);
+  mesh.vertices.emplace_back(-1.0F, 1.0F, 0.0F);
+  mesh.faces.emplace_back(1, 2, 3);
+  mesh.faces.emplace_back(1, 3, 4);
+  const CompressedMesh compressed = compress_mesh(mesh);
+
+  constexpr int size = 32;
+  const TGAImage viewport(size, size, TGAImage::RGB);
+  FrameArena arena {};
+  const auto &submesh = compressed.submeshes.front();
+  const auto screen = arena.allocate<OBJVertex<float>>(submesh.positions.size());
+  const auto normals = arena.allocate<std::array<float, 3>>(submesh.positions.size());
+  const auto uvs = arena.allocate<std::array<float, 2>>(submesh.positions.size());
+  transform_submesh(compressed, submesh, viewport, screen, normals, uvs);
+  for (std::size_t index = 0; index < submesh.positions.size(); ++index) {
+    // the generated normals of a quad wound counter-clockwise point at the viewer; no uvs in the file means zero uvs
+    REQUIRE(std::abs(normals[index][2] - 1.0F) < 1e-5F);
+    REQUIRE(uvs[index][0] == 0.0F);
+    REQUIRE(uvs[index][1] == 0.0F);
+  }
+
+  // facing the headlight, so fully lit: face_color up to the truncation of the interpolated intensity
+  TGAImage img(size, size, TGAImage::RGB);
+  TGAImage zbuffer(size, size, TGAImage::GRAYSCALE);
+  arena.reset();
+  draw_compressed(img, compressed, zbuffer, arena);
+  const auto lit_as = [](const TGAColor &actual, const std::size_t face) {
+    const TGAColor expected = face_color(face);
+    for (int channel = 0; channel < 3; ++channel) {
+      if (std::abs(actual[channel] - expected[channel]) > 1) { return false; }
+    }
+    return true;
+  };
+  for (int y = 0; y < size - 1; ++y) {
+    for (int x = 0; x < size - 1; ++x) {
+      // pixels on the shared diagonal may belong to either face
+      const TGAColor actual = img.get(x, y);
+      REQUIRE((x > y ? lit_as(actual, 0) : x < y ? lit_as(actual, 1) : lit_as(actual, 0) || lit_as(actual, 1)));
+    }
+  }
+}
@@ -0,0 +1,70 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "deferred.hpp"
+#include "frame_memory.hpp"
+#include "objreader.hpp"
+#include "rasterizer.hpp"
+#include "render_test_helpers.hpp"
+#include "tgaimage.hpp"
+
+#include <cstddef>
+#include <stdexcept>
+
+namespace {
+
+constexpr int size = 64;
+
+}// namespace
+
+TEST_CASE("Depth pre-pass produces the z-buffer of draw_triangles", "[deferred]")
+{
+  const OBJObject<float> mesh = make_layered_mesh(size);
+  TGAImage color(size, size, TGAImage::RGB);
+  TGAImage forward_depth(size, size, TGAImage::GRAYSCALE);
+  draw_triangles<float>(color, mesh.vertices, mesh.faces, forward_depth);
+
+  TGAImage prepass_depth(size, size, TGAImage::GRAYSCALE);
+  depth_prepass(prepass_depth, mesh.vertices, mesh.faces);
+  REQUIRE(same_pixels(forward_depth, prepass_depth));
+}
+
+TEST_CASE("Deferred passes shade each visible pixel once and match the forward image", "[deferred]")
+{
+  const OBJObject<float> mesh = make_layered_mesh(size);
+  const auto flat = [](const std::size_t face, float, float, float) { return face_color(face); };
+
+  TGAImage forward(size, size, TGAImage::RGB);
+  TGAImage forward_depth(size, size, TGAImage::GRAYSCALE);
+  const std::size_t forward_invocations = shade_forward(forward, forward_depth, mesh.vertices, mesh.faces, flat);
+
+  std::size_t covered = 0;
+  for (int y = 0; y < size; ++y) {
+    for (int x = 0; x < size; ++x) { covered += forward_depth.get(x, y)[0] > 0 ? 1U : 0U; }
+  }
+
+  TGAImage equal(size, size, TGAImage::RGB);
+  TGAImage equal_depth(size, size, TGAImage::GRAYSCALE);
+  depth_prepass(equal_depth, mesh.vertices, mesh.faces);
+  FrameArena arena {};
+  const std::size_t equal_invocations = shade_equal_depth(equal, equal_depth, mesh.vertices, mesh.faces, arena, flat);
+
+  TGAImage visible(size, size, TGAImage::RGB);
+  TGAImage visible_depth(size, size, TGAImage::GRAYSCALE);
+  VisibilityBuffer visibility(size, size);
+  fill_visibility(visibility, visible_depth, mesh.vertices, mesh.faces);
+  const std::size_t visible_invocations = shade_visibility(visible, visibility, flat);
+
+  REQUIRE(forward_invocations > covered);
+  REQUIRE(equal_invocations == covered);
+  REQUIRE(visible_invocations == covered);
+  REQUIRE(same_pixels(forward, equal));
+  REQUIRE(same_pixels(forward, visible));
+}
+
+TEST_CASE("Faces with undefined vertices throw instead of reading out of bounds", "[deferred]")
+{
+  OBJObject<float> mesh = make_layered_mesh(size);
+  mesh.faces.emplace_back(1, 0, 2);
+  TGAImage zbuffer(size, size, TGAImage::GRAYSCALE);
+  REQUIRE_THROWS_AS(depth_prepass(zbuffer, mesh.vertices, mesh.faces), std::out_of_range);
+}
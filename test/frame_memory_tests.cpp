@@ -0,0 +1,144 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "batch.hpp"
+#include "frame_memory.hpp"
+#include "objreader.hpp"
+#include "render_test_helpers.hpp"
+#include "tgaimage.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <new>
+#include <string>
+
+namespace {
+std::atomic<std::size_t> allocation_count { 0 };
+}// namespace
+
+// count every heap allocation made through any form of operator new; this file is its own test executable, so
+// only these tests run on the replaced allocator
+namespace {
+void *counted_allocation(const std::size_t size, const std::size_t alignment)
+{
+  ++allocation_count;
+  const std::size_t bytes = size == 0 ? 1 : size;
+  if (alignment <= __STDCPP_DEFAULT_NEW_ALIGNMENT__) { return std::malloc(bytes); }
+  return std::aligned_alloc(alignment, (bytes + alignment - 1) / alignment * alignment);
+}
+
+void *checked(void *memory)
+{
+  if (nullptr == memory) { throw std::bad_alloc(); }
+  return memory;
+}
+}// namespace
+
+void *operator new(std::size_t size) { return checked(counted_allocation(size, 0)); }
+void *operator new[](std::size_t size) { return checked(counted_allocation(size, 0)); }
+void *operator new(std::size_t size, std::align_val_t align) { return checked(counted_allocation(size, static_cast<std::size_t>(align))); }
+void *operator new[](std::size_t size, std::align_val_t align) { return checked(counted_allocation(size, static_cast<std::size_t>(align))); }
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept { return counted_allocation(size, 0); }
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept { return counted_allocation(size, 0); }
+void *operator new(std::size_t size, std::align_val_t align, const std::nothrow_t &) noexcept
+{
+  return counted_allocation(size, static_cast<std::size_t>(align));
+}
+void *operator new[](std::size_t size, std::align_val_t align, const std::nothrow_t &) noexcept
+{
+  return counted_allocation(size, static_cast<std::size_t>(align));
+}
+
+void operator delete(void *memory) noexcept { std::free(memory); }
+void operator delete[](void *memory) noexcept { std::free(memory); }
+void operator delete(void *memory, std::size_t) noexcept { std::free(memory); }
+void operator delete[](void *memory, std::size_t) noexcept { std::free(memory); }
+void operator delete(void *memory, std::align_val_t) noexcept { std::free(memory); }
+void operator delete[](void *memory, std::align_val_t) noexcept { std::free(memory); }
+void operator delete(void *memory, std::size_t, std::align_val_t) noexcept { std::free(memory); }
+void operator delete[](void *memory, std::size_t, std::align_val_t) noexcept { std::free(memory); }
+void operator delete(void *memory, const std::nothrow_t &) noexcept { std::free(memory); }
+void operator delete[](void *memory, const std::nothrow_t &) noexcept { std::free(memory); }
+
+TEST_CASE("Frame arena grows to the high-water mark and then stops allocating", "[frame_memory]")
+{
+  FrameArena arena;
+  std::size_t total = 0;
+  for (const std::size_t count : { 16U, 100U, 7U }) {
+    const auto span = arena.allocate<double>(count);
+    REQUIRE(span.size() == count);
+    REQUIRE(reinterpret_cast<std::uintptr_t>(span.data()) % alignof(double) == 0);
+    total += count * sizeof(double);
+  }
+  REQUIRE(arena.high_water() >= total);
+  arena.reset();
+  REQUIRE(arena.capacity() >= total);
+  REQUIRE(arena.used() == 0);
+
+  const std::size_t before = allocation_count;
+  for (int frame = 0; frame < 4; ++frame) {
+    [[maybe_unused]] const auto first = arena.allocate<double>(16);
+    [[maybe_unused]] const auto second = arena.allocate<double>(100);
+    [[maybe_unused]] const auto third = arena.allocate<double>(7);
+    arena.reset();
+  }
+  const std::size_t after = allocation_count;
+  REQUIRE(after == before);
+}
+
+TEST_CASE("Image pool recycles images of the same size and format", "[frame_memory]")
+{
+  ImagePool pool;
+  TGAImage &first = pool.acquire(8, 8, TGAImage::RGB, TGAColor(1, 2, 3, 255));
+  first.set(0, 0, TGAColor(9, 9, 9, 255));
+  TGAImage &second = pool.acquire(8, 8, TGAImage::RGB);
+  REQUIRE(&first != &second);
+  pool.reset();
+
+  TGAImage &recycled = pool.acquire(8, 8, TGAImage::RGB, TGAColor(1, 2, 3, 255));
+  REQUIRE(&recycled == &first);
+  REQUIRE(recycled.get(0, 0)[0] == 1);
+  REQUIRE(pool.size() == 2);
+}
+
+TEST_CASE("Batch frames make no heap allocations in steady state", "[frame_memory]")
+{
+  const OBJObject<float> mesh = make_grid_mesh(16);
+  const auto output_dir = std::filesystem::temp_directory_path();
+  BatchJob job {};
+  job.model = "grid";
+  job.width = 64;
+  job.height = 64;
+  job.frames = 12;
+  job.yaw_end = 90.0F;
+  job.pitch = 20.0F;
+  job.output_pattern = (output_dir / "bloatedrenderer_frame_memory_{frame}.tga").string();
+  FrameResources frame;
+  std::string output_path;
+
+  // warm-up frames size the arena, the pools and the output path
+  REQUIRE(render_batch_frame(job, 0, mesh, frame, output_path));
+  REQUIRE(render_batch_frame(job, 1, mesh, frame, output_path));
+
+  // every frame has a different rotation, so a different image and encoded size
+  const std::size_t before = allocation_count;
+  bool written = true;
+  for (int frame_index = 2; frame_index < job.frames; ++frame_index) {
+    written = render_batch_frame(job, frame_index, mesh, frame, output_path) && written;
+  }
+  const std::size_t after = allocation_count;
+
+  REQUIRE(written);
+  REQUIRE(after == before);
+  REQUIRE(frame.images.size() == 2);
+  REQUIRE(frame.byte_buffers.size() == 1);
+
+  TGAImage last {};
+  REQUIRE(last.read_tga_file(output_path));
+  REQUIRE(last.width() == job.width);
+  for (int frame_index = 0; frame_index < job.frames; ++frame_index) {
+    std::filesystem::remove(expand_output_pattern(job.output_pattern, job.model, frame_index));
+  }
+}
@@ -0,0 +1,97 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "incremental.hpp"
+#include "objreader.hpp"
+#include "render_test_helpers.hpp"
+#include "tgaimage.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace {
+
+constexpr int size = 96;
+constexpr int tile_size = 16;
+
+// renders the placements from scratch
+IncrementalRenderer render_full(const std::vector<OBJObject<float>> &meshes, const std::vector<ObjectPlacement> &placements)
+{
+  IncrementalRenderer renderer(size, size, tile_size);
+  for (std::size_t index = 0; index < meshes.size(); ++index) { renderer.add_object(meshes[index], placements[index]); }
+  const IncrementalStats stats = renderer.render_frame();
+  REQUIRE(stats.dirty_tiles == stats.total_tiles);
+  return renderer;
+}
+
+}// namespace
+
+TEST_CASE("Incremental frames match a full redraw", "[incremental]")
+{
+  std::vector<OBJObject<float>> meshes;
+  std::vector<ObjectPlacement> placements;
+  for (std::uint32_t index = 0; index < 6; ++index) {
+    meshes.push_back(make_cluster_mesh(index + 3));
+    const float position = (static_cast<float>(index) * 0.3F) - 0.75F;
+    placements.push_back({ { position, -position, 0.0F }, 1.0F, true });
+  }
+  IncrementalRenderer renderer(size, size, tile_size);
+  for (std::size_t index = 0; index < meshes.size(); ++index) { renderer.add_object(meshes[index], placements[index]); }
+  const IncrementalStats first = renderer.render_frame();
+  REQUIRE(first.dirty_tiles == first.total_tiles);
+  REQUIRE(renderer.render_frame().dirty_tiles == 0);
+
+  // move one object across others, then hide one, then push one partly off screen
+  for (int frame = 0; frame < 4; ++frame) {
+    placements[2].offset[0] += 0.15F;
+    placements[2].offset[2] = frame % 2 == 0 ? 0.3F : -0.3F;
+    if (frame == 2) { placements[4].visible = false; }
+    if (frame == 3) { placements[0].offset = { -1.1F, 0.9F, 0.0F }; }
+    for (std::size_t index = 0; index < meshes.size(); ++index) { renderer.set_placement(index, placements[index]); }
+    const IncrementalStats stats = renderer.render_frame();
+    REQUIRE(stats.dirty_tiles > 0);
+    REQUIRE(stats.dirty_tiles < stats.total_tiles);
+
+    const IncrementalRenderer reference = render_full(meshes, placements);
+    REQUIRE(same_pixels(reference.color(), renderer.color()));
+    REQUIRE(same_pixels(reference.depth(), renderer.depth()));
+  }
+}
+
+TEST_CASE("Dirty regions cover exactly the dirty tiles", "[incremental]")
+{
+  const OBJObject<float> mesh = make_cluster_mesh(5);
+  IncrementalRenderer renderer(size, size, tile_size);
+  renderer.add_object(mesh, { { -0.5F, -0.5F, 0.0F }, 1.0F, true });
+  const IncrementalStats first = renderer.render_frame();
+  REQUIRE(first.regions.size() == 1);
+  REQUIRE(first.regions[0].width() == size);
+  REQUIRE(first.regions[0].height() == size);
+
+  const ScreenRect old_bounds = renderer.bounds(0);
+  renderer.set_placement(0, { { 0.5F, 0.5F, 0.0F }, 1.0F, true });
+  const IncrementalStats moved = renderer.render_frame();
+  std::size_t covered = 0;
+  for (const ScreenRect &rect : moved.regions) {
+    REQUIRE(rect.x_min % tile_size == 0);
+    REQUIRE(rect.y_min % tile_size == 0);
+    covered += static_cast<std::size_t>(rect.width() / tile_size) * static_cast<std::size_t>(rect.height() / tile_size);
+  }
+  REQUIRE(covered == moved.dirty_tiles);
+  // old and new bounds are far apart, so they cannot share a region
+  REQUIRE(moved.regions.size() >= 2);
+  REQUIRE(moved.regions.front().x_min <= old_bounds.x_min);
+  REQUIRE(moved.regions.front().y_min <= old_bounds.y_min);
+
+  const TGAImage region = extract_region(renderer.color(), moved.regions.back());
+  REQUIRE(region.width() == moved.regions.back().width());
+  REQUIRE(region.height() == moved.regions.back().height());
+  for (int y = 0; y < region.height(); ++y) {
+    for (int x = 0; x < region.width(); ++x) {
+      REQUIRE(region.get(x, y)[0] == renderer.color().get(x + moved.regions.back().x_min, y + moved.regions.back().y_min)[0]);
+    }
+  }
+
+  REQUIRE(renderer.render_frame().dirty_tiles == 0);
+}
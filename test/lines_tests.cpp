@@ -0,0 +1,107 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "lines.hpp"
+#include "objreader.hpp"
+#include "render_test_helpers.hpp"
+#include "tgaimage.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+namespace {
+
+const TGAColor line_color(10, 20, 30, 255);
+
+int count_pixels(const TGAImage &img)
+{
+  int count = 0;
+  for (int y = 0; y < img.height(); ++y) {
+    for (int x = 0; x < img.width(); ++x) { count += img.get(x, y)[0] == line_color[0] ? 1 : 0; }
+  }
+  return count;
+}
+
+}// namespace
+
+TEST_CASE("Lines cover one pixel per step along the major axis in every octant", "[lines]")
+{
+  constexpr int size = 32;
+  const std::array<std::array<int, 2>, 10> ends { { { 30, 16 }, { 2, 16 }, { 16, 30 }, { 16, 2 }, { 30, 21 }, { 2, 9 }, { 21, 30 }, { 9, 2 }, { 30, 30 }, { 16, 16 } } };
+  for (const auto &end : ends) {
+    TGAImage img(size, size, TGAImage::RGB);
+    draw_line(16, 16, end[0], end[1], img, line_color);
+    REQUIRE(img.get(16, 16)[0] == line_color[0]);
+    REQUIRE(img.get(end[0], end[1])[0] == line_color[0]);
+    REQUIRE(count_pixels(img) == std::max(std::abs(end[0] - 16), std::abs(end[1] - 16)) + 1);
+  }
+}
+
+TEST_CASE("Lines are clipped to the image", "[lines]")
+{
+  LineSegment inside { 1, 2, 0, 5, 6, 0 };
+  REQUIRE(clip_line(inside, 8, 8));
+  REQUIRE(inside.x0 == 1);
+  REQUIRE(inside.y1 == 6);
+
+  LineSegment outside { -10, -5, 0, -1, 20, 0 };
+  REQUIRE_FALSE(clip_line(outside, 8, 8));
+
+  LineSegment crossing { -8, 4, 0, 24, 4, 255 };
+  REQUIRE(clip_line(crossing, 8, 8));
+  REQUIRE(crossing.x0 == 0);
+  REQUIRE(crossing.x1 == 7);
+  REQUIRE(crossing.z0 == 64);
+
+  TGAImage img(8, 8, TGAImage::GRAYSCALE);
+  draw_line(-100, -100, 100, 100, img, line_color);
+  REQUIRE(count_pixels(img) == 8);
+}
+
+TEST_CASE("Lines grazing a corner are kept inside the image", "[lines]")
+{
+  // both pass within half a pixel of a corner pixel centre; clipping with rounded intersections used to drop them
+  LineSegment top_right { 6, 8, 0, 19, 0, 0 };
+  REQUIRE(clip_line(top_right, 8, 8));
+  REQUIRE(top_right.x0 == 7);
+  REQUIRE(top_right.y0 == 7);
+  LineSegment steep { 11, -11, 0, 5, 17, 0 };
+  REQUIRE(clip_line(steep, 8, 8));
+
+  // endpoints of every kept line are pixels of the image
+  TestRandom random(9);
+  const auto next = [&] { return static_cast<int>(random.next(200U)) - 100; };
+  for (int index = 0; index < 100000; ++index) {
+    LineSegment line { next(), next(), 0, next(), next(), 255 };
+    if (!clip_line(line, 8, 8)) { continue; }
+    for (const int coord : { line.x0, line.y0, line.x1, line.y1 }) {
+      REQUIRE(coord >= 0);
+      REQUIRE(coord < 8);
+    }
+    REQUIRE(line.z0 >= 0);
+    REQUIRE(line.z1 <= 255);
+  }
+}
+
+TEST_CASE("Depth-tested lines only show in front of the z-buffer", "[lines]")
+{
+  TGAImage img(16, 16, TGAImage::RGB);
+  TGAImage zbuffer(16, 16, TGAImage::GRAYSCALE, TGAColor(100, 100, 100, 255));
+  const std::vector<LineSegment> lines { { 0, 2, 99, 15, 2, 99 }, { 0, 8, 90, 15, 8, 90 } };
+  draw_lines_depth(img, zbuffer, lines, line_color, 2);
+  REQUIRE(img.get(7, 2)[0] == line_color[0]);
+  REQUIRE(img.get(7, 8)[0] != line_color[0]);
+  REQUIRE(zbuffer.get(7, 2)[0] == 100);
+}
+
+TEST_CASE("Shared edges are extracted once", "[lines]")
+{
+  OBJObject<float> quad {};
+  quad.faces.emplace_back(1, 2, 3);
+  quad.faces.emplace_back(1, 3, 4);
+  const auto edges = extract_edges(quad.faces);
+  REQUIRE(edges.size() == 5);
+  REQUIRE((edges.front() == std::array<std::uint32_t, 2> { 0, 1 }));
+}
@@ -0,0 +1,224 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "meshlets.hpp"
+#include "objreader.hpp"
+#include "rasterizer.hpp"
+#include "render_test_helpers.hpp"
+#include "tgaimage.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+namespace {
+
+constexpr int size = 128;
+
+// the sphere the culling and cache tests load from disk
+std::filesystem::path write_sphere_obj(const std::filesystem::path &path) { return write_obj(path, make_sphere_mesh(24, 48, 0.8F)); }
+
+// the mesh rotated into the view and transformed to the screen like the batch turntable
+OBJObject<float> to_screen(const OBJObject<float> &mesh, const ClusterView &view)
+{
+  OBJObject<float> rotated = mesh;
+  for (auto &vert : rotated.vertices) {
+    const auto coords = vert.vertex_coords;
+    for (std::size_t axis = 0; axis < 3; ++axis) {
+      vert.vertex_coords.at(axis) = (view.rotation.at(axis)[0] * coords[0]) + (view.rotation.at(axis)[1] * coords[1])
+                                    + (view.rotation.at(axis)[2] * coords[2]);
+    }
+  }
+  rotated.viewport_transform(TGAImage(size, size, TGAImage::GRAYSCALE));
+  return rotated;
+}
+
+// faces of the mesh that face the viewer in this view
+bool front_facing(const OBJObject<float> &screen, const OBJFaceElements &face)
+{
+  const auto &vert_a = screen.vertices[static_cast<std::size_t>(face.face_vertices.at(0) - 1)];
+  const auto &vert_b = screen.vertices[static_cast<std::size_t>(face.face_vertices.at(1) - 1)];
+  const auto &vert_c = screen.vertices[static_cast<std::size_t>(face.face_vertices.at(2) - 1)];
+  const float signed_area = ((vert_b.get_x() - vert_a.get_x()) * (vert_c.get_y() - vert_a.get_y()))
+                            - ((vert_c.get_x() - vert_a.get_x()) * (vert_b.get_y() - vert_a.get_y()));
+  return signed_area > 0.0F;
+}
+
+}// namespace
+
+TEST_CASE("Meshlet culling is conservative", "[meshlets]")
+{
+  const auto path = write_sphere_obj(std::filesystem::temp_directory_path() / "bloatedrenderer_meshlets_cull.obj");
+  OBJObject<float> mesh {};
+  REQUIRE(read_obj(path, mesh));
+  std::filesystem::remove(path);
+  const std::size_t face_total = mesh.faces.size();
+  const MeshletBVH bvh = build_meshlets(mesh, 32);
+  REQUIRE(mesh.faces.size() == face_total);
+
+  for (const auto &[yaw, pitch] : { std::array { 0.0F, 0.0F }, std::array { 90.0F, 0.0F }, std::array { 45.0F, 30.0F }, std::array { 200.0F, -60.0F } }) {
+    ClusterView view = make_turntable_view(yaw, pitch);
+    const OBJObject<float> screen = to_screen(mesh, view);
+    std::vector<std::uint32_t> visible;
+    CullStats stats {};
+    cull_meshlets(bvh, view, visible, stats);
+    REQUIRE(stats.faces_visible < face_total);
+
+    // every face that faces the viewer is in a visible meshlet
+    std::vector<bool> drawn(face_total, false);
+    for (const std::uint32_t meshlet : visible) {
+      for (std::uint32_t face = 0; face < bvh.meshlets[meshlet].face_count; ++face) { drawn[bvh.meshlets[meshlet].first_face + face] = true; }
+    }
+    for (std::size_t face = 0; face < face_total; ++face) {
+      if (front_facing(screen, mesh.faces[face])) { REQUIRE(drawn[face]); }
+    }
+
+    // so the culled frame is the unculled one: back faces of a closed mesh never win the depth test
+    TGAImage all(size, size, TGAImage::RGB);
+    TGAImage all_depth(size, size, TGAImage::GRAYSCALE);
+    draw_triangles<float>(all, screen.vertices, screen.faces, all_depth);
+    TGAImage culled(size, size, TGAImage::RGB);
+    TGAImage culled_depth(size, size, TGAImage::GRAYSCALE);
+    draw_meshlets<float>(culled, screen.vertices, screen.faces, bvh, visible, culled_depth);
+    for (int y = 0; y < size; ++y) {
+      for (int x = 0; x < size; ++x) {
+        REQUIRE(culled_depth.get(x, y)[0] == all_depth.get(x, y)[0]);
+        for (int channel = 0; channel < TGAImage::RGB; ++channel) { REQUIRE(culled.get(x, y)[channel] == all.get(x, y)[channel]); }
+      }
+    }
+
+    // frustum culling alone, against the upper right quarter of the screen
+    view.backface_culling = false;
+    view.box_min = { 0.0F, 0.0F, -1.0F };
+    visible.clear();
+    stats = {};
+    cull_meshlets(bvh, view, visible, stats);
+    REQUIRE(stats.faces_visible < face_total);
+    culled.clear();
+    culled_depth.clear();
+    draw_meshlets<float>(culled, screen.vertices, screen.faces, bvh, visible, culled_depth);
+    for (int y = (size / 2) + 1; y < size; ++y) {
+      for (int x = (size / 2) + 1; x < size; ++x) {
+        for (int channel = 0; channel < TGAImage::RGB; ++channel) { REQUIRE(culled.get(x, y)[channel] == all.get(x, y)[channel]); }
+      }
+    }
+  }
+}
+
+TEST_CASE("The meshlet cache round-trips and is rebuilt when the mesh file changes", "[meshlets]")
+{
+  const auto path = write_sphere_obj(std::filesystem::temp_directory_path() / "bloatedrenderer_meshlets_cache.obj");
+  const auto cache = std::filesystem::path(path.string() + ".meshlets");
+  std::filesystem::remove(cache);
+  OBJObject<float> source {};
+  REQUIRE(read_obj(path, source));
+
+  OBJObject<float> built = source;
+  bool from_cache = true;
+  const MeshletBVH first = load_or_build_meshlets(path, built, from_cache);
+  REQUIRE_FALSE(from_cache);
+  REQUIRE(std::filesystem::exists(cache));
+
+  OBJObject<float> cached = source;
+  const MeshletBVH second = load_or_build_meshlets(path, cached, from_cache);
+  REQUIRE(from_cache);
+  REQUIRE(second.face_order == first.face_order);
+  REQUIRE(second.meshlets.size() == first.meshlets.size());
+  REQUIRE(second.nodes.size() == first.nodes.size());
+  for (std::size_t index = 0; index < first.meshlets.size(); ++index) {
+    REQUIRE(second.meshlets[index].first_face == first.meshlets[index].first_face);
+    REQUIRE(second.meshlets[index].radius == first.meshlets[index].radius);
+    REQUIRE(second.meshlets[index].cone_sin == first.meshlets[index].cone_sin);
+  }
+  // the cached face order is applied to the mesh like build_meshlets does
+  for (std::size_t face = 0; face < source.faces.size(); ++face) { REQUIRE(cached.faces[face].face_vertices == built.faces[face].face_vertices); }
+
+  // a new modification time alone invalidates the cache
+  const auto written = std::filesystem::last_write_time(path);
+  std::filesystem::last_write_time(path, written + std::chrono::seconds(5));
+  cached = source;
+  load_or_build_meshlets(path, cached, from_cache);
+  REQUIRE_FALSE(from_cache);
+  cached = source;
+  load_or_build_meshlets(path, cached, from_cache);
+  REQUIRE(from_cache);
+
+  // so does a new size with the modification time the cache saw
+  const auto rebuilt = std::filesystem::last_write_time(path);
+  std::ofstream(path, std::ios::app) << "# appended\n";
+  std::filesystem::last_write_time(path, rebuilt);
+  cached = source;
+  load_or_build_meshlets(path, cached, from_cache);
+  REQUIRE_FALSE(from_cache);
+
+  std::filesystem::remove(path);
+  std::filesystem::remove(cache);
+}
+
+TEST_CASE("Corrupt meshlet caches are rejected and rebuilt", "[meshlets]")
+{
+  const auto path = write_sphere_obj(std::filesystem::temp_directory_path() / "bloatedrenderer_meshlets_corrupt.obj");
+  const auto cache = std::filesystem::path(path.string() + ".meshlets");
+  std::filesystem::remove(cache);
+  OBJObject<float> source {};
+  REQUIRE(read_obj(path, source));
+  OBJObject<float> built = source;
+  bool from_cache = true;
+  const MeshletBVH bvh = load_or_build_meshlets(path, built, from_cache);
+  REQUIRE(bvh.nodes.front().count == 0);
+  std::ifstream in(cache, std::ios::binary);
+  const std::vector<char> original { std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>() };
+  in.close();
+
+  // header: 8 byte magic, 32 bit version and meshlet count, then five 64 bit fields ending with the node count;
+  // the face order, the meshlets and the nodes follow
+  constexpr std::size_t meshlet_count_at = 12;
+  constexpr std::size_t node_count_at = 48;
+  constexpr std::size_t face_order_at = 56;
+  const std::size_t meshlets_at = face_order_at + (source.faces.size() * sizeof(std::uint32_t));
+  const std::size_t nodes_at = meshlets_at + (bvh.meshlets.size() * sizeof(Meshlet));
+  const auto patched = [&](const std::size_t offset, const auto value) {
+    std::vector<char> bytes = original;
+    std::memcpy(bytes.data() + offset, &value, sizeof(value));
+    std::ofstream(cache, std::ios::binary).write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    OBJObject<float> loaded = source;
+    load_or_build_meshlets(path, loaded, from_cache);
+    for (std::size_t face = 0; face < source.faces.size(); ++face) { REQUIRE(loaded.faces[face].face_vertices == built.faces[face].face_vertices); }
+    return !from_cache;
+  };
+  std::uint32_t leaf = 0;
+  while (bvh.nodes[leaf].count == 0) { leaf = bvh.nodes[leaf].first; }
+
+  REQUIRE(patched(meshlet_count_at, std::uint32_t { 0xFFFFFFFFU }));
+  REQUIRE(patched(node_count_at, std::uint64_t { 1 } << 40U));
+  REQUIRE(patched(face_order_at + sizeof(std::uint32_t), bvh.face_order[0]));
+  REQUIRE(patched(face_order_at, static_cast<std::uint32_t>(source.faces.size())));
+  REQUIRE(patched(meshlets_at + offsetof(Meshlet, face_count), static_cast<std::uint32_t>(source.faces.size() + 1)));
+  REQUIRE(patched(meshlets_at + offsetof(Meshlet, face_count), std::uint32_t { 0 }));
+  // the root as its own child, a child pointing past the nodes, and a leaf past the meshlets
+  REQUIRE(patched(nodes_at + offsetof(MeshletNode, first), std::uint32_t { 0 }));
+  REQUIRE(patched(nodes_at + offsetof(MeshletNode, first), static_cast<std::uint32_t>(bvh.nodes.size() - 1)));
+  REQUIRE(patched(nodes_at + (leaf * sizeof(MeshletNode)) + offsetof(MeshletNode, count), static_cast<std::uint32_t>(bvh.meshlets.size() + 1)));
+  // unpatched, the cache is used again
+  REQUIRE_FALSE(patched(0, original[0]));
+
+  std::filesystem::remove(path);
+  std::filesystem::remove(cache);
+}
+
+TEST_CASE("An empty mesh has no meshlet tree", "[meshlets]")
+{
+  OBJObject<float> mesh {};
+  const MeshletBVH bvh = build_meshlets(mesh);
+  REQUIRE(bvh.meshlets.empty());
+  REQUIRE(bvh.nodes.empty());
+  std::vector<std::uint32_t> visible;
+  CullStats stats {};
+  cull_meshlets(bvh, ClusterView {}, visible, stats);
+  REQUIRE(visible.empty());
+}
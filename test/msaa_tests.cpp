@@ -0,0 +1,176 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "msaa.hpp"
+#include "tgaimage.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace {
+
+constexpr int size = 16;
+
+const TGAColor first_color(200, 40, 0, 255);
+const TGAColor second_color(0, 120, 240, 255);
+const TGAColor third_color(90, 250, 10, 255);
+
+// true when the resolved pixel is the rounded average of `samples` samples split k1/k2/k3 over the three colours
+bool is_sample_average(const TGAColor &resolved, const int samples)
+{
+  for (int first = 0; first <= samples; ++first) {
+    for (int second = 0; first + second <= samples; ++second) {
+      const int third = samples - first - second;
+      bool matches = true;
+      for (int channel = 0; channel < 4; ++channel) {
+        const int sum = (first * first_color[channel]) + (second * second_color[channel]) + (third * third_color[channel]);
+        matches = matches && resolved[channel] == (sum + (samples / 2)) / samples;
+      }
+      if (matches) { return true; }
+    }
+  }
+  return false;
+}
+
+bool same_color(const TGAColor &lhs, const TGAColor &rhs)
+{
+  return lhs[0] == rhs[0] && lhs[1] == rhs[1] && lhs[2] == rhs[2] && lhs[3] == rhs[3];
+}
+
+// a triangle far larger than the framebuffer covers every sample of every pixel
+void fill_screen(MSAAFramebuffer &msaa, const float depth, const TGAColor &color)
+{
+  msaa.fill_triangle(-100.0F, -100.0F, depth, 200.0F, -100.0F, depth, -100.0F, 200.0F, depth, [&](float, float, float) { return color; });
+}
+
+}// namespace
+
+TEST_CASE("MSAA sample counts above 4 select 8, others 4", "[msaa]")
+{
+  REQUIRE(MSAAFramebuffer(4, 4, 1).samples() == 4);
+  REQUIRE(MSAAFramebuffer(4, 4, 4).samples() == 4);
+  REQUIRE(MSAAFramebuffer(4, 4, 5).samples() == 8);
+  REQUIRE(MSAAFramebuffer(4, 4, 8).samples() == 8);
+}
+
+TEST_CASE("Fully covered pixels keep a single colour and resolve exactly", "[msaa]")
+{
+  for (const int samples : { 4, 8 }) {
+    MSAAFramebuffer msaa(size, size, samples);
+    fill_screen(msaa, 100.0F, first_color);
+    REQUIRE(msaa.complex_pixels() == 0);
+
+    TGAImage img(size, size, TGAImage::RGBA);
+    msaa.resolve(img);
+    for (int y = 0; y < size; ++y) {
+      for (int x = 0; x < size; ++x) { REQUIRE(same_color(img.get(x, y), first_color)); }
+    }
+  }
+}
+
+TEST_CASE("A shared edge resolves to the average of both colours", "[msaa]")
+{
+  for (const int samples : { 4, 8 }) {
+    MSAAFramebuffer msaa(size, size, samples);
+    // the square split along its diagonal, both halves at the same depth
+    const auto s = static_cast<float>(size);
+    msaa.fill_triangle(0.0F, 0.0F, 100.0F, s, 0.0F, 100.0F, s, s, 100.0F, [](float, float, float) { return first_color; });
+    msaa.fill_triangle(0.0F, 0.0F, 100.0F, s, s, 100.0F, 0.0F, s, 100.0F, [](float, float, float) { return second_color; });
+    REQUIRE(msaa.complex_pixels() > 0);
+
+    TGAImage img(size, size, TGAImage::RGBA);
+    msaa.resolve(img);
+    for (int y = 0; y < size; ++y) {
+      for (int x = 0; x < size; ++x) {
+        const TGAColor resolved = img.get(x, y);
+        if (x > y) {
+          REQUIRE(same_color(resolved, first_color));
+        } else if (x < y) {
+          REQUIRE(same_color(resolved, second_color));
+        } else {
+          // on the diagonal both colours contribute
+          REQUIRE_FALSE(same_color(resolved, first_color));
+          REQUIRE_FALSE(same_color(resolved, second_color));
+          REQUIRE(is_sample_average(resolved, samples));
+        }
+      }
+    }
+  }
+}
+
+TEST_CASE("Pixels split three ways allocate pool slots and collapse when covered again", "[msaa]")
+{
+  MSAAFramebuffer msaa(size, size, 8);
+  fill_screen(msaa, 50.0F, third_color);
+  // two triangles meeting inside pixel (8, 8): it ends up with samples of all three colours
+  msaa.fill_triangle(8.5F, 8.5F, 100.0F, 16.0F, 8.5F, 100.0F, 16.0F, 16.0F, 100.0F, [](float, float, float) { return first_color; });
+  msaa.fill_triangle(8.5F, 8.5F, 100.0F, 8.5F, 16.0F, 100.0F, 0.0F, 16.0F, 100.0F, [](float, float, float) { return second_color; });
+
+  TGAImage img(size, size, TGAImage::RGBA);
+  msaa.resolve(img);
+  const TGAColor corner = img.get(8, 8);
+  REQUIRE(is_sample_average(corner, 8));
+  REQUIRE_FALSE(same_color(corner, first_color));
+  REQUIRE_FALSE(same_color(corner, second_color));
+  REQUIRE_FALSE(same_color(corner, third_color));
+  const std::size_t complex = msaa.complex_pixels();
+  REQUIRE(complex > 0);
+
+  // a closer full-screen fragment owns every sample again
+  fill_screen(msaa, 200.0F, first_color);
+  REQUIRE(msaa.complex_pixels() == 0);
+  msaa.resolve(img);
+  REQUIRE(same_color(img.get(8, 8), first_color));
+}
+
+TEST_CASE("Blocks of collapsed pixels are reused by later edges", "[msaa]")
+{
+  for (const int samples : { 4, 8 }) {
+    MSAAFramebuffer msaa(size, size, samples);
+    const auto s = static_cast<float>(size);
+    // each round splits the diagonal pixels, then a closer full-screen fragment collapses them again
+    const auto overdraw = [&](const int round) {
+      const auto depth = static_cast<float>(10 * round);
+      msaa.fill_triangle(0.0F, 0.0F, depth + 5.0F, s, 0.0F, depth + 5.0F, s, s, depth + 5.0F, [](float, float, float) { return second_color; });
+      fill_screen(msaa, depth + 9.0F, first_color);
+    };
+    overdraw(1);
+    const std::size_t one_round = msaa.pool_high_water_bytes();
+    REQUIRE(one_round >= static_cast<std::size_t>(size * samples) * sizeof(std::uint32_t));
+    for (int round = 2; round < 20; ++round) { overdraw(round); }
+    REQUIRE(msaa.pool_high_water_bytes() == one_round);
+    REQUIRE(msaa.complex_pixels() == 0);
+
+    // reused blocks start from the pixel's current colour, not the previous owner's slots
+    msaa.fill_triangle(0.0F, 0.0F, 250.0F, s, 0.0F, 250.0F, s, s, 250.0F, [](float, float, float) { return third_color; });
+    TGAImage img(size, size, TGAImage::RGBA);
+    msaa.resolve(img);
+    for (int y = 0; y < size; ++y) {
+      const TGAColor diagonal = img.get(y, y);
+      REQUIRE(is_sample_average(diagonal, samples));
+      for (int channel = 0; channel < 4; ++channel) {
+        // only the first and third colours contribute: no second colour left over from earlier rounds
+        const int low = std::min(first_color[channel], third_color[channel]);
+        const int high = std::max(first_color[channel], third_color[channel]);
+        REQUIRE(diagonal[channel] >= low);
+        REQUIRE(diagonal[channel] <= high);
+      }
+    }
+  }
+}
+
+TEST_CASE("Resolved depth is the closest sample", "[msaa]")
+{
+  MSAAFramebuffer msaa(size, size, 4);
+  fill_screen(msaa, 100.0F, first_color);
+  msaa.fill_triangle(4.0F, 4.0F, 200.0F, 12.0F, 4.0F, 200.0F, 4.0F, 12.0F, 200.0F, [](float, float, float) { return second_color; });
+
+  TGAImage zbuffer(size, size, TGAImage::GRAYSCALE);
+  msaa.resolve_depth(zbuffer);
+  REQUIRE(zbuffer.get(5, 5)[0] == 200);
+  REQUIRE(zbuffer.get(14, 14)[0] == 100);
+  // partially covered edge pixels take the larger depth too
+  REQUIRE(zbuffer.get(8, 7)[0] == 200);
+  REQUIRE(zbuffer.get(0, 0)[0] == 100);
+}
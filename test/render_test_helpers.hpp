@@ -0,0 +1,180 @@
+#ifndef RENDER_TEST_HELPERS_HPP
+#define RENDER_TEST_HELPERS_HPP
+#include "objreader.hpp"
+#include "tgaimage.hpp"
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <numbers>
+
+// Fixtures shared by the renderer test files.
+
+// numerical recipes LCG: the same seed gives the same meshes on every platform
+class TestRandom
+{
+public:
+  explicit TestRandom(const std::uint32_t seed) : state(seed) {}
+
+  // in [0, range)
+  std::uint32_t next(const std::uint32_t range)
+  {
+    state = (state * 1664525U) + 1013904223U;
+    return (state >> 8U) % range;
+  }
+
+private:
+  std::uint32_t state;
+};
+
+struct LayeredMeshSpec
+{
+  std::uint32_t seed = 7;
+  int triangles = 200;
+  // corners may lie this many pixels outside the image
+  int margin = 8;
+  // screen depths are depth_min + [0, depth_range)
+  int depth_min = 0;
+  std::uint32_t depth_range = 256;
+};
+
+// overlapping screen space triangles of a size x size image at random depths, several layers deep everywhere
+inline OBJObject<float> make_layered_mesh(const int size, const LayeredMeshSpec &spec = {})
+{
+  OBJObject<float> mesh {};
+  TestRandom random(spec.seed);
+  const auto extent = static_cast<std::uint32_t>(size + (2 * spec.margin));
+  for (int index = 0; index < spec.triangles; ++index) {
+    for (int corner = 0; corner < 3; ++corner) {
+      const auto x_coord = static_cast<float>(random.next(extent)) - static_cast<float>(spec.margin);
+      const auto y_coord = static_cast<float>(random.next(extent)) - static_cast<float>(spec.margin);
+      const auto z_coord = static_cast<float>(random.next(spec.depth_range)) + static_cast<float>(spec.depth_min);
+      mesh.vertices.emplace_back(x_coord, y_coord, z_coord);
+    }
+    mesh.faces.emplace_back((index * 3) + 1, (index * 3) + 2, (index * 3) + 3);
+  }
+  return mesh;
+}
+
+// cells x cells quads over [-1, 1]^2 in normalized device coordinates, two counter-clockwise triangles each, on the
+// saddle z = x * y / 2 so depth varies across the screen; vertices are numbered row by row from (-1, -1)
+inline OBJObject<float> make_grid_mesh(const int cells)
+{
+  OBJObject<float> mesh {};
+  for (int j = 0; j <= cells; ++j) {
+    for (int i = 0; i <= cells; ++i) {
+      const float x_coord = (2.0F * static_cast<float>(i) / static_cast<float>(cells)) - 1.0F;
+      const float y_coord = (2.0F * static_cast<float>(j) / static_cast<float>(cells)) - 1.0F;
+      mesh.vertices.emplace_back(x_coord, y_coord, 0.5F * x_coord * y_coord);
+    }
+  }
+  for (int j = 0; j < cells; ++j) {
+    for (int i = 0; i < cells; ++i) {
+      const int corner = (j * (cells + 1)) + i + 1;
+      mesh.faces.emplace_back(corner, corner + 1, corner + cells + 2);
+      mesh.faces.emplace_back(corner, corner + cells + 2, corner + cells + 1);
+    }
+  }
+  return mesh;
+}
+
+// evenly spread unit vectors, both hemispheres and the octahedron's folds included
+inline std::array<float, 3> sphere_direction(const int index, const int count)
+{
+  const float height = 1.0F - (2.0F * (static_cast<float>(index) + 0.5F) / static_cast<float>(count));
+  const float radius = std::sqrt(1.0F - (height * height));
+  const float angle = static_cast<float>(index) * std::numbers::pi_v<float> * (3.0F - std::sqrt(5.0F));
+  return { radius * std::cos(angle), radius * std::sin(angle), height };
+}
+
+// closed sphere around the origin with counter-clockwise faces seen from outside: a pole vertex at +y, rings - 1
+// rings of segments vertices, a pole vertex at -y
+inline OBJObject<float> make_sphere_mesh(const int rings, const int segments, const float radius)
+{
+  OBJObject<float> mesh {};
+  mesh.vertices.emplace_back(0.0F, radius, 0.0F);
+  for (int ring = 1; ring < rings; ++ring) {
+    const float polar = std::numbers::pi_v<float> * static_cast<float>(ring) / static_cast<float>(rings);
+    for (int segment = 0; segment < segments; ++segment) {
+      const float azimuth = 2.0F * std::numbers::pi_v<float> * static_cast<float>(segment) / static_cast<float>(segments);
+      mesh.vertices.emplace_back(radius * std::sin(polar) * std::sin(azimuth), radius * std::cos(polar), radius * std::sin(polar) * std::cos(azimuth));
+    }
+  }
+  mesh.vertices.emplace_back(0.0F, -radius, 0.0F);
+  const auto ring_vertex = [&](const int ring, const int segment) { return 2 + ((ring - 1) * segments) + (segment % segments); };
+  const int bottom = 2 + ((rings - 1) * segments);
+  for (int segment = 0; segment < segments; ++segment) {
+    mesh.faces.emplace_back(1, ring_vertex(1, segment), ring_vertex(1, segment + 1));
+    for (int ring = 1; ring + 1 < rings; ++ring) {
+      mesh.faces.emplace_back(ring_vertex(ring, segment), ring_vertex(ring + 1, segment), ring_vertex(ring + 1, segment + 1));
+      mesh.faces.emplace_back(ring_vertex(ring, segment), ring_vertex(ring + 1, segment + 1), ring_vertex(ring, segment + 1));
+    }
+    mesh.faces.emplace_back(ring_vertex(rings - 1, segment), bottom, ring_vertex(rings - 1, segment + 1));
+  }
+  return mesh;
+}
+
+// vertices and faces as OBJ text, for tests that need the mesh on disk
+inline std::filesystem::path write_obj(const std::filesystem::path &path, const OBJObject<float> &mesh)
+{
+  std::ofstream out(path);
+  for (const auto &vert : mesh.vertices) { out << "v " << vert.get_x() << " " << vert.get_y() << " " << vert.get_z() << "\n"; }
+  for (const auto &face : mesh.faces) {
+    out << "f " << face.face_vertices[0] << " " << face.face_vertices[1] << " " << face.face_vertices[2] << "\n";
+  }
+  return path;
+}
+
+// triangles small enough to move around the screen as one object: corners within 0.2 of the origin in x and y, depths
+// in [-0.5, 0.5), in normalized device coordinates
+inline OBJObject<float> make_cluster_mesh(const std::uint32_t seed, const int triangles = 40)
+{
+  OBJObject<float> mesh {};
+  TestRandom random(seed);
+  const auto next = [&] { return (static_cast<float>(random.next(1000U)) / 1000.0F) - 0.5F; };
+  for (int index = 0; index < triangles; ++index) {
+    for (int corner = 0; corner < 3; ++corner) { mesh.vertices.emplace_back(next() * 0.4F, next() * 0.4F, next()); }
+    mesh.faces.emplace_back((index * 3) + 1, (index * 3) + 2, (index * 3) + 3);
+  }
+  return mesh;
+}
+
+// floor quad facing the viewer at z = -0.5 and a square occluder above it at z = 0, both in normalized device
+// coordinates and wound counter-clockwise seen from +z
+inline OBJObject<float> make_occluder_scene()
+{
+  OBJObject<float> mesh {};
+  for (const std::array<float, 3> &vert : { std::array { -1.0F, -1.0F, -0.5F },
+         std::array { 1.0F, -1.0F, -0.5F },
+         std::array { 1.0F, 1.0F, -0.5F },
+         std::array { -1.0F, 1.0F, -0.5F },
+         std::array { 0.2F, -0.2F, 0.0F },
+         std::array { 0.6F, -0.2F, 0.0F },
+         std::array { 0.6F, 0.2F, 0.0F },
+         std::array { 0.2F, 0.2F, 0.0F } }) {
+    mesh.vertices.emplace_back(vert[0], vert[1], vert[2]);
+  }
+  mesh.faces.emplace_back(1, 2, 3);
+  mesh.faces.emplace_back(1, 3, 4);
+  mesh.faces.emplace_back(5, 6, 7);
+  mesh.faces.emplace_back(5, 7, 8);
+  return mesh;
+}
+
+// same size, format and bytes in every pixel
+inline bool same_pixels(const TGAImage &lhs, const TGAImage &rhs)
+{
+  if (lhs.width() != rhs.width() || lhs.height() != rhs.height() || lhs.bytes_per_pixel() != rhs.bytes_per_pixel()) { return false; }
+  for (int y = 0; y < lhs.height(); ++y) {
+    for (int x = 0; x < lhs.width(); ++x) {
+      for (int channel = 0; channel < lhs.bytes_per_pixel(); ++channel) {
+        if (lhs.get(x, y)[channel] != rhs.get(x, y)[channel]) { return false; }
+      }
+    }
+  }
+  return true;
+}
+
+#endif //RENDER_TEST_HELPERS_HPP
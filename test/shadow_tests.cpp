@@ -0,0 +1,148 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "deferred.hpp"
+#include "objreader.hpp"
+#include "rasterizer.hpp"
+#include "render_test_helpers.hpp"
+#include "shadow.hpp"
+#include "tgaimage.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+constexpr int size = 64;
+
+// corners up to 8 pixels off the map, depths 1..255
+const LayeredMeshSpec mesh_spec { 5, 200, 8, 1, 255 };
+
+int to_pixel(const float ndc) { return static_cast<int>((ndc + 1.0F) * static_cast<float>(size / 2)); }
+
+}// namespace
+
+TEST_CASE("Depth-only kernels agree with the depth pre-pass", "[shadow]")
+{
+  const OBJObject<float> mesh = make_layered_mesh(size, mesh_spec);
+  TGAImage prepass(size, size, TGAImage::GRAYSCALE);
+  depth_prepass(prepass, mesh.vertices, mesh.faces);
+
+  std::vector<std::uint8_t> plain(static_cast<std::size_t>(size) * size, 0);
+  std::vector<std::uint8_t> early_out(plain.size(), 0);
+  for (const auto &face : mesh.faces) {
+    const auto corners = face_corners(mesh.vertices, face);
+    fill_depth_only<false>(plain.data(), size, size, corners[0], corners[1], corners[2]);
+    fill_depth_only<true>(early_out.data(), size, size, corners[0], corners[1], corners[2]);
+  }
+  REQUIRE(plain == early_out);
+  // same coverage; depth is exact here and may differ from the float barycentrics by one step
+  for (int y = 0; y < size; ++y) {
+    for (int x = 0; x < size; ++x) {
+      const int expected = prepass.get(x, y)[0];
+      const int actual = plain[(static_cast<std::size_t>(y) * size) + static_cast<std::size_t>(x)];
+      REQUIRE((0 == expected) == (0 == actual));
+      REQUIRE(actual - expected <= 1);
+      REQUIRE(expected - actual <= 1);
+    }
+  }
+}
+
+TEST_CASE("draw_triangles shades deterministically like shade_forward", "[shadow]")
+{
+  const OBJObject<float> mesh = make_layered_mesh(size, mesh_spec);
+  TGAImage color(size, size, TGAImage::RGB);
+  TGAImage depth(size, size, TGAImage::GRAYSCALE);
+  draw_triangles<float>(color, mesh.vertices, mesh.faces, depth);
+
+  TGAImage expected(size, size, TGAImage::RGB);
+  TGAImage expected_depth(size, size, TGAImage::GRAYSCALE);
+  shade_forward(expected, expected_depth, mesh.vertices, mesh.faces, [](const std::size_t face, float, float, float) {
+    return face_color(face);
+  });
+  for (int y = 0; y < size; ++y) {
+    for (int x = 0; x < size; ++x) {
+      for (int channel = 0; channel < TGAImage::RGB; ++channel) { REQUIRE(color.get(x, y)[channel] == expected.get(x, y)[channel]); }
+    }
+  }
+}
+
+TEST_CASE("Occluded pixels only receive ambient light", "[shadow]")
+{
+  const OBJObject<float> mesh = make_occluder_scene();
+  OBJObject<float> screen_mesh = mesh;
+  TGAImage img(size, size, TGAImage::RGB);
+  screen_mesh.viewport_transform(img);
+  TGAImage zbuffer(size, size, TGAImage::GRAYSCALE);
+  VisibilityBuffer visibility(size, size);
+  fill_visibility(visibility, zbuffer, screen_mesh.vertices, screen_mesh.faces);
+
+  // light from the right at 45 degrees: the occluder's shadow lands half an NDC unit to its left
+  ShadowMap shadow_map(256);
+  shadow_map.set_light({ 1.0F, 0.0F, 1.0F });
+  shadow_map.render(mesh, false);
+  const std::vector<std::uint8_t> plain(shadow_map.depth().row(0), shadow_map.depth().row(0) + (256 * 256));
+  shadow_map.render(mesh, true);
+  REQUIRE(std::equal(plain.begin(), plain.end(), shadow_map.depth().row(0)));
+
+  const ShadowShading shading {};
+  REQUIRE(shade_shadowed(img, visibility, mesh.vertices, mesh.faces, shadow_map, shading) == static_cast<std::size_t>(size) * size);
+
+  const auto shaded_as = [&](const int x, const int y, const float lit) {
+    const std::size_t face = visibility.face_ids[(static_cast<std::size_t>(y) * size) + static_cast<std::size_t>(x)];
+    const float n_dot_l = 1.0F / std::sqrt(2.0F);
+    const float intensity = shading.ambient + ((1.0F - shading.ambient) * n_dot_l * lit);
+    const TGAColor base = face_color(face);
+    for (int channel = 0; channel < 3; ++channel) {
+      const int expected = static_cast<int>(static_cast<float>(base[channel]) * intensity);
+      if (std::abs(img.get(x, y)[channel] - expected) > 1) { return false; }
+    }
+    return true;
+  };
+  // in the shadow, beside it, and on the occluder itself
+  REQUIRE(shaded_as(to_pixel(-0.1F), to_pixel(0.0F), 0.0F));
+  REQUIRE(shaded_as(to_pixel(-0.7F), to_pixel(0.0F), 1.0F));
+  REQUIRE(shaded_as(to_pixel(0.4F), to_pixel(0.0F), 1.0F));
+  REQUIRE(shaded_as(to_pixel(-0.1F), to_pixel(0.6F), 1.0F));
+}
+
+TEST_CASE("PCF filters the shadow edge", "[shadow]")
+{
+  const OBJObject<float> mesh = make_occluder_scene();
+  ShadowMap shadow_map(128);
+  shadow_map.set_light({ 0.0F, 0.0F, 1.0F });
+  shadow_map.render(mesh);
+  REQUIRE(shadow_map.resolution() == 128);
+
+  // floor points under the occluder, far from it and on its left edge
+  const auto inside = shadow_map.to_light({ 0.4F, 0.0F, -0.5F });
+  const auto outside = shadow_map.to_light({ -0.6F, 0.0F, -0.5F });
+  const auto edge = shadow_map.to_light({ 0.2F, 0.0F, -0.5F });
+  const std::array lookups { inside, outside, edge };
+  std::array<float, 3> lit {};
+  shadow_map.lookup_pcf(lookups, 2, 2.0F, lit);
+  REQUIRE(lit[0] == 0.0F);
+  REQUIRE(lit[1] == 1.0F);
+  REQUIRE(lit[2] > 0.0F);
+  REQUIRE(lit[2] < 1.0F);
+
+  shadow_map.lookup_pcf(lookups, 0, 2.0F, lit);
+  REQUIRE((lit[2] == 0.0F || lit[2] == 1.0F));
+}
+
+TEST_CASE("Faces with undefined vertices throw instead of reading out of bounds", "[shadow]")
+{
+  OBJObject<float> mesh = make_occluder_scene();
+  mesh.faces.emplace_back(1, 2, 9);
+  ShadowMap shadow_map(32);
+  REQUIRE_THROWS_AS(shadow_map.render(mesh), std::out_of_range);
+
+  TGAImage img(size, size, TGAImage::RGB);
+  const VisibilityBuffer visibility(size, size);
+  REQUIRE_THROWS_AS(shade_shadowed(img, visibility, mesh.vertices, mesh.faces, shadow_map, ShadowShading {}), std::out_of_range);
+}
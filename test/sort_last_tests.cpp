@@ -0,0 +1,44 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "deferred.hpp"
+#include "objreader.hpp"
+#include "rasterizer.hpp"
+#include "render_test_helpers.hpp"
+#include "sort_last.hpp"
+#include "tgaimage.hpp"
+
+#include <cstddef>
+#include <utility>
+
+namespace {
+
+constexpr int size = 96;
+
+// corners inside the image and depths in a narrow band, so every worker's face range overlaps the others
+const LayeredMeshSpec mesh_spec { 11, 500, 0, 100, 64 };
+
+}// namespace
+
+TEST_CASE("Sort-last compositing matches a single in-order pass", "[sort_last]")
+{
+  const OBJObject<float> mesh = make_layered_mesh(size, mesh_spec);
+  TGAImage expected(size, size, TGAImage::RGB);
+  TGAImage expected_depth(size, size, TGAImage::GRAYSCALE);
+  shade_forward(expected, expected_depth, mesh.vertices, mesh.faces, [](const std::size_t face, float, float, float) {
+    return face_color(face);
+  });
+
+  for (const auto &[workers, method] : { std::pair { 1, CompositeMethod::tree },
+         std::pair { 3, CompositeMethod::tree },
+         std::pair { 4, CompositeMethod::tree },
+         std::pair { 4, CompositeMethod::binary_swap },
+         std::pair { 5, CompositeMethod::binary_swap } }) {
+    TGAImage color(size, size, TGAImage::RGB);
+    TGAImage depth(size, size, TGAImage::GRAYSCALE);
+    SortLastStats stats {};
+    REQUIRE(render_sort_last(mesh, workers, method, color, depth, stats));
+    REQUIRE(stats.workers == workers);
+    REQUIRE(same_pixels(expected, color));
+    REQUIRE(same_pixels(expected_depth, depth));
+  }
+}
@@ -0,0 +1,119 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "deferred.hpp"
+#include "objreader.hpp"
+#include "rasterizer.hpp"
+#include "streaming.hpp"
+#include "render_test_helpers.hpp"
+#include "tgaimage.hpp"
+
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+
+namespace {
+
+constexpr int size = 128;
+
+// three wavy grids stacked in depth, written with v/vt/vn corners and vertices interleaved with the faces
+std::filesystem::path write_layered_obj(const int cells)
+{
+  const auto path = std::filesystem::temp_directory_path() / "bloatedrenderer_streaming_test.obj";
+  std::ofstream out(path);
+  out << "vt 0 0\nvn 0 0 1\n";
+  int vertex_base = 0;
+  for (int layer = 0; layer < 3; ++layer) {
+    for (int j = 0; j <= cells; ++j) {
+      for (int i = 0; i <= cells; ++i) {
+        const float x_coord = (2.0F * static_cast<float>(i) / static_cast<float>(cells)) - 1.0F;
+        const float y_coord = (2.0F * static_cast<float>(j) / static_cast<float>(cells)) - 1.0F;
+        const float z_coord = (0.3F * static_cast<float>(layer - 1)) + (0.4F * std::sin(4.0F * (x_coord + y_coord + static_cast<float>(layer))));
+        out << "v " << x_coord << ' ' << y_coord << ' ' << z_coord << '\n';
+      }
+    }
+    for (int j = 0; j < cells; ++j) {
+      for (int i = 0; i < cells; ++i) {
+        const int corner = vertex_base + (j * (cells + 1)) + i + 1;
+        out << "f " << corner << "/1/1 " << corner + 1 << "/1/1 " << corner + cells + 2 << "/1/1\n";
+        out << "f " << corner << "/1/1 " << corner + cells + 2 << "/1/1 " << corner + cells + 1 << "/1/1\n";
+      }
+    }
+    vertex_base += (cells + 1) * (cells + 1);
+  }
+  return path;
+}
+
+}// namespace
+
+TEST_CASE("Streaming render matches the in-memory render from OBJ and binary meshes", "[streaming]")
+{
+  const auto obj_path = write_layered_obj(60);
+  const auto binary_path = std::filesystem::path(obj_path).replace_extension(".brmesh");
+
+  OBJObject<float> mesh {};
+  REQUIRE(read_obj(obj_path, mesh));
+  TGAImage expected(size, size, TGAImage::RGB);
+  TGAImage expected_depth(size, size, TGAImage::GRAYSCALE);
+  mesh.viewport_transform(expected);
+  shade_forward(expected, expected_depth, mesh.vertices, mesh.faces, [](const std::size_t face, float, float, float) {
+    return face_color(face);
+  });
+
+  StreamOptions options {};
+  options.memory_budget = std::size_t { 256 } * 1024;
+  REQUIRE(convert_to_binary_mesh(obj_path, binary_path, options.chunk_bytes()));
+
+  for (const auto &path : { obj_path, binary_path }) {
+    TGAImage color(size, size, TGAImage::RGB);
+    TGAImage depth(size, size, TGAImage::GRAYSCALE);
+    StreamStats stats {};
+    REQUIRE(render_streaming(path, options, color, depth, stats));
+    REQUIRE(stats.faces == mesh.faces.size());
+    REQUIRE(stats.chunks > 10);
+    REQUIRE(stats.peak_bytes <= options.memory_budget);
+    REQUIRE(same_pixels(expected, color));
+    REQUIRE(same_pixels(expected_depth, depth));
+  }
+
+  // a binary mesh with chunks larger than the budget is refused instead of overrunning it
+  StreamOptions small_options {};
+  small_options.memory_budget = options.memory_budget / 8;
+  TGAImage color(size, size, TGAImage::RGB);
+  TGAImage depth(size, size, TGAImage::GRAYSCALE);
+  StreamStats stats {};
+  REQUIRE_FALSE(render_streaming(binary_path, small_options, color, depth, stats));
+
+  std::filesystem::remove(obj_path);
+  std::filesystem::remove(binary_path);
+}
+
+TEST_CASE("Malformed meshes are rejected", "[streaming]")
+{
+  const auto path = std::filesystem::temp_directory_path() / "bloatedrenderer_streaming_malformed.obj";
+  for (const char *contents : { "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 4\n", "v 0 0 0\nv 1 zero 0\nv 0 1 0\nf 1 2 3\n", "v 0 0\n" }) {
+    std::ofstream(path) << contents;
+    MeshChunkReader reader;
+    REQUIRE(reader.open(path, 4096));
+    MeshChunk chunk {};
+    REQUIRE_FALSE(reader.next(chunk));
+    REQUIRE(reader.failed());
+  }
+
+  // binary meshes are stored in host byte order; a file from a host with the other order has a swapped version
+  {
+    std::ofstream out(path, std::ios::binary);
+    const std::array<char, 8> magic = { 'B', 'R', 'M', 'E', 'S', 'H', '\0', '\0' };
+    const std::array<std::uint32_t, 2> version_and_chunks = { std::byteswap(std::uint32_t { 1 }), 0 };
+    const std::uint64_t faces = 0;
+    out.write(magic.data(), magic.size());
+    out.write(reinterpret_cast<const char *>(version_and_chunks.data()), sizeof(version_and_chunks));
+    out.write(reinterpret_cast<const char *>(&faces), sizeof(faces));
+  }
+  MeshChunkReader reader;
+  REQUIRE_FALSE(reader.open(path, 4096));
+  std::filesystem::remove(path);
+}